@@ -54,11 +54,17 @@
 
 #include "Solver.h"
 #include "CPUSolver.h"
+#include "CPUBatchSolver.h"
+#include "CPURedBlackSolver.h"
+#include "MultigridSolver.h"
+#include "PCGSolver.h"
 #include "DynamicParallelism.h"
 #include "GlobalMemory.h"
 #include "SharedMemory.h"
 
 #include "Sensor.h"
+#include "Timers.h"
+#include "BuildingScheduler.h"
 
 namespace pt = boost::property_tree;
 
@@ -74,12 +80,28 @@ namespace pt = boost::property_tree;
 WINDSInputData* parseXMLTree(const std::string fileName);
 Sensor* parseSensors (const std::string fileName);
 
+/**
+ * This function builds the initial velocity field of a time step from
+ * the sensors and applies the building parameterizations to it.
+ * @param index the time step (index of the sensor data)
+ */
+void setInitialFields(WINDSInputData* WID, WINDSGeneralData* WGD, int index, int solveType);
+
+/**
+ * This function writes the timing of the phases of the run, if a
+ * timing report file is set.
+ */
+void writeTimingReport(const std::string fileName);
+
 int main(int argc, char *argv[])
 {
     // QES-Winds - Version output information
     std::string Revision = "0";
     std::cout << "QES-Winds " << "1.0.0" << std::endl;
 
+    // Start timing the whole run
+    TimerRegistry::instance();
+
 #ifdef HAS_OPTIX
     std::cout << "OptiX is available!" << std::endl;
 #endif
@@ -99,7 +121,9 @@ int main(int argc, char *argv[])
     // ///////////////////////////////////
 
     // Parse the base XML QUIC file -- contains simulation parameters
+    TimerRegistry::instance().start("parse input");
     WINDSInputData* WID = parseXMLTree(arguments.quicFile);
+    TimerRegistry::instance().stop();
     if ( !WID ) {
         std::cerr << "[ERROR] QUIC Input file: " << arguments.quicFile <<
             " not able to be read successfully." << std::endl;
@@ -109,6 +133,7 @@ int main(int argc, char *argv[])
     // If the sensor file specified in the xml
     if (WID->metParams->sensorName.size() > 0)
     {
+        ScopedTimer timer("parse sensors");
         for (auto i = 0; i < WID->metParams->sensorName.size(); i++)
   		  {
             WID->metParams->sensors.push_back(new Sensor());            // Create new sensor object
@@ -126,10 +151,20 @@ int main(int argc, char *argv[])
 
 
     if (arguments.terrainOut) {
+        // The DEM is not loaded when the geometry is in the cache
+        WID->simParams->loadTerrain();
         if (WID->simParams->DTE_heightField) {
-            std::cout << "Creating terrain OBJ....\n";
-            WID->simParams->DTE_heightField->outputOBJ(arguments.filenameTerrain);
-            std::cout << "OBJ created....\n";
+            ScopedTimer timer("terrain output");
+            if (arguments.terrainFormat == "ply") {
+                std::cout << "Creating terrain PLY....\n";
+                WID->simParams->DTE_heightField->outputPLY(arguments.filenameTerrain);
+                std::cout << "PLY created....\n";
+            }
+            else {
+                std::cout << "Creating terrain OBJ....\n";
+                WID->simParams->DTE_heightField->outputOBJ(arguments.filenameTerrain);
+                std::cout << "OBJ created....\n";
+            }
         }
         else {
             std::cerr << "[ERROR] No dem file specified as input\n";
@@ -138,9 +173,12 @@ int main(int argc, char *argv[])
     }
 
     // Generate the general WINDS data from all inputs
+    TimerRegistry::instance().start("WINDSGeneralData");
     WINDSGeneralData* WGD = new WINDSGeneralData(WID, arguments.solveType);
+    TimerRegistry::instance().stop();
 
     // create WINDS output classes
+    TimerRegistry::instance().start("output setup");
     std::vector<QESNetCDFOutput*> outputVec;
     if (arguments.visuOutput) {
         outputVec.push_back(new WINDSOutputVisualization(WGD,WID,arguments.netCDFFileVisu));
@@ -148,6 +186,7 @@ int main(int argc, char *argv[])
     if (arguments.wkspOutput) {
         outputVec.push_back(new WINDSOutputWorkspace(WGD,arguments.netCDFFileWksp));
     }
+    TimerRegistry::instance().stop();
 
 
     /*// Generate the general TURB data from WINDS data
@@ -166,7 +205,13 @@ int main(int argc, char *argv[])
     //
     // //////////////////////////////////////////
     Solver *solver, *solverC = nullptr;
-    if (arguments.solveType == CPU_Type) {
+    CPUBatchSolver *batchSolver = nullptr;
+    if (arguments.solveType == CPU_Type && WID->simParams->batchScenarios > 1) {
+        std::cout << "Run Batched Serial Solver (CPU), " << WID->simParams->batchScenarios
+                  << " scenarios per batch ..." << std::endl;
+        batchSolver = new CPUBatchSolver(WID, WGD);
+        solver = batchSolver;
+    } else if (arguments.solveType == CPU_Type) {
         std::cout << "Run Serial Solver (CPU) ..." << std::endl;
         solver = new CPUSolver(WID, WGD);
     } else if (arguments.solveType == DYNAMIC_P) {
@@ -178,6 +223,15 @@ int main(int argc, char *argv[])
     } else if (arguments.solveType == Shared_M) {
         std::cout << "Run Shared Memory Solver (GPU) ..." << std::endl;
         solver = new SharedMemory(WID, WGD);
+    } else if (arguments.solveType == CPU_RedBlack) {
+        std::cout << "Run Red-Black Multithreaded Solver (CPU) ..." << std::endl;
+        solver = new CPURedBlackSolver(WID, WGD);
+    } else if (arguments.solveType == CPU_Multigrid) {
+        std::cout << "Run Geometric Multigrid Solver (CPU) ..." << std::endl;
+        solver = new MultigridSolver(WID, WGD);
+    } else if (arguments.solveType == CPU_PCG) {
+        std::cout << "Run Preconditioned Conjugate Gradient Solver (CPU) ..." << std::endl;
+        solver = new PCGSolver(WID, WGD);
     } else {
         std::cerr << "[ERROR] invalid solve type\n";
         exit(EXIT_FAILURE);
@@ -193,19 +247,104 @@ int main(int argc, char *argv[])
             solverC = new GlobalMemory(WID, WGD);
         else if (arguments.compareType == Shared_M)
             solverC = new SharedMemory(WID, WGD);
+        else if (arguments.compareType == CPU_RedBlack)
+            solverC = new CPURedBlackSolver(WID, WGD);
+        else if (arguments.compareType == CPU_Multigrid)
+            solverC = new MultigridSolver(WID, WGD);
+        else if (arguments.compareType == CPU_PCG)
+            solverC = new PCGSolver(WID, WGD);
         else {
             std::cerr << "[ERROR] invalid comparison type\n";
             exit(EXIT_FAILURE);
         }
     }
 
+    if (batchSolver != nullptr && solverC != nullptr) {
+        std::cout << "[WARNING] compareType is not supported with batchScenarios, "
+                  << "the comparison solve is skipped" << std::endl;
+        solverC = nullptr;
+    }
+
+    if (WID->simParams->batchScenarios > 1 && batchSolver == nullptr) {
+        std::cout << "[WARNING] batchScenarios is only supported by the serial solver (CPU), "
+                  << "time steps are solved one at a time" << std::endl;
+    }
+
+    // ///////////////////////////////////////
+    //
+    // Batched mode: the time steps are independent inflow scenarios
+    // on the same domain, solved batchScenarios at a time
+    //
+    // ///////////////////////////////////////
+    if (batchSolver != nullptr)
+    {
+        int numScenarios = MAX_S(1, WID->simParams->totalTimeIncrements);
+        int batchSize = WID->simParams->batchScenarios;
+        std::chrono::duration<float> elapsedScenarios(0.0);    /// Time to set up and solve the scenarios
+
+        for (int first = 0; first < numScenarios; first += batchSize)
+        {
+            ScopedTimer timer("batch");
+            auto startBatch = std::chrono::high_resolution_clock::now();
+
+            // The initial fields of the first time step are built with WGD
+            for (int index = first; index < MIN_S(first + batchSize, numScenarios); index++)
+            {
+                if (index > 0)
+                {
+                    ScopedTimer timer("initial fields");
+                    setInitialFields(WID, WGD, index, arguments.solveType);
+                }
+                batchSolver->addScenario(WGD);
+            }
+            TimerRegistry::instance().start("solve");
+            batchSolver->solveBatch(WID, WGD, !arguments.solveWind);
+            TimerRegistry::instance().stop();
+
+            std::cout << "Solver done!\n";
+            elapsedScenarios += std::chrono::high_resolution_clock::now() - startBatch;
+
+            ScopedTimer timerOutput("output save");
+            for (int s = 0; s < batchSolver->numScenarios(); s++)
+            {
+                if (!arguments.solveWind)
+                {
+                    batchSolver->loadScenario(WGD, s);
+                }
+                else
+                {
+                    batchSolver->loadScenarioFlags(WGD, s);
+                }
+                for(auto id_out=0u;id_out<outputVec.size();id_out++)
+                {
+                    outputVec.at(id_out)->save((float) (first + s));
+                }
+            }
+            batchSolver->clearScenarios();
+        }
+
+        std::cout << "Batched solve: " << numScenarios << " scenarios in " << elapsedScenarios.count() << " s ("
+                  << numScenarios*3600.0/elapsedScenarios.count() << " scenarios per hour)\n";
+
+        writeTimingReport(arguments.timingReportFile);
+        exit(EXIT_SUCCESS);
+    }
+
     // Run WINDS simulation code
+    TimerRegistry::instance().start("solve");
     solver->solve(WID, WGD, !arguments.solveWind );
+    TimerRegistry::instance().stop();
 
     std::cout << "Solver done!\n";
 
+    // Iterations of the first (cold) solve, used to report the savings
+    // of the warm-started solves of the next time steps
+    int coldIterations = solver->getIterations();
+    long totalSaved = 0;
+
     if (solverC != nullptr) {
         std::cout << "Running comparson type...\n";
+        ScopedTimer timer("comparison solve");
         solverC->solve(WID, WGD, !arguments.solveWind);
     }
 
@@ -222,10 +361,12 @@ int main(int argc, char *argv[])
     // Output the various files requested from the simulation run
     // (netcdf wind velocity, icell values, etc...
     // /////////////////////////////
+    TimerRegistry::instance().start("output save");
     for(auto id_out=0u;id_out<outputVec.size();id_out++)
     {
         outputVec.at(id_out)->save(0.0); // need to replace 0.0 with timestep
     }
+    TimerRegistry::instance().stop();
 
     ///////////////////////////////////////
     ////
@@ -237,115 +378,37 @@ int main(int argc, char *argv[])
     {
       for (int index = 1; index < WID->simParams->totalTimeIncrements; index++)
       {
-        // Reset icellflag values
-        for (int k = 0; k < WGD->nz-2; k++)
-        {
-            for (int j = 0; j < WGD->ny-1; j++)
-            {
-                for (int i = 0; i < WGD->nx-1; i++)
-                {
-                    int icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);
-                    if (WGD->icellflag[icell_cent] != 0 && WGD->icellflag[icell_cent] != 2 && WGD->icellflag[icell_cent] != 8 && WGD->icellflag[icell_cent] != 7)
-                    {
-                      WGD->icellflag[icell_cent] = 1;
-                    }
-                }
-            }
-        }
+        ScopedTimer timer("time step");
 
-        // Create initial velocity field from the new sensors
-        WID->metParams->sensors[0]->inputWindProfile(WID, WGD, index, arguments.solveType);
-
-        // ///////////////////////////////////////
-        // Canopy Vegetation Parameterization
-        // ///////////////////////////////////////
-        for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
-        {
-            // for now this does the canopy stuff for us
-            WGD->allBuildingsV[WGD->building_id[i]]->canopyVegetation(WGD);
-        }
-
-        ///////////////////////////////////////////
-        //   Upwind Cavity Parameterization     ///
-        ///////////////////////////////////////////
-        if (WID->simParams->upwindCavityFlag > 0)
-        {
-            std::cout << "Applying upwind cavity parameterization...\n";
-            for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
-            {
-                WGD->allBuildingsV[WGD->building_id[i]]->upwindCavity(WID, WGD);
-            }
-            std::cout << "Upwind cavity parameterization done...\n";
-        }
-
-        //////////////////////////////////////////////////
-        //   Far-Wake and Cavity Parameterizations     ///
-        //////////////////////////////////////////////////
-        if (WID->simParams->wakeFlag > 0)
-        {
-            std::cout << "Applying wake behind building parameterization...\n";
-            for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
-            {
-                WGD->allBuildingsV[WGD->building_id[i]]->polygonWake(WID, WGD, WGD->building_id[i]);
-            }
-            std::cout << "Wake behind building parameterization done...\n";
-        }
-
-        ///////////////////////////////////////////
-        //   Street Canyon Parameterization     ///
-        ///////////////////////////////////////////
-        if (WID->simParams->streetCanyonFlag > 0)
-        {
-            std::cout << "Applying street canyon parameterization...\n";
-            for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
-            {
-                WGD->allBuildingsV[WGD->building_id[i]]->streetCanyon(WGD);
-            }
-            std::cout << "Street canyon parameterization done...\n";
-        }
-
-        ///////////////////////////////////////////
-        //      Sidewall Parameterization       ///
-        ///////////////////////////////////////////
-        if (WID->simParams->sidewallFlag > 0)
-        {
-            std::cout << "Applying sidewall parameterization...\n";
-            for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
-            {
-                WGD->allBuildingsV[WGD->building_id[i]]->sideWall(WID, WGD);
-            }
-            std::cout << "Sidewall parameterization done...\n";
-        }
-
-
-        ///////////////////////////////////////////
-        //      Rooftop Parameterization        ///
-        ///////////////////////////////////////////
-        if (WID->simParams->rooftopFlag > 0)
-        {
-            std::cout << "Applying rooftop parameterization...\n";
-            for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
-            {
-                WGD->allBuildingsV[WGD->building_id[i]]->rooftop (WID, WGD);
-            }
-            std::cout << "Rooftop parameterization done...\n";
-        }
-
-        WGD->wall->setVelocityZero (WGD);
+        TimerRegistry::instance().start("initial fields");
+        setInitialFields(WID, WGD, index, arguments.solveType);
+        TimerRegistry::instance().stop();
 
         // Run WINDS simulation code
+        TimerRegistry::instance().start("solve");
         solver->solve(WID, WGD, !arguments.solveWind );
+        TimerRegistry::instance().stop();
 
         std::cout << "Solver done!\n";
 
+        if (WID->simParams->warmStart > 0 && !arguments.solveWind && coldIterations > 0)
+        {
+            int saved = coldIterations - solver->getIterations();
+            totalSaved += saved;
+            std::cout << "Warm start: " << solver->getIterations() << " iterations at time step " << index
+                      << " (" << saved << " saved compared to the first step, " << totalSaved << " in total)\n";
+        }
+
         // /////////////////////////////
         // Output the various files requested from the simulation run
         // (netcdf wind velocity, icell values, etc...
         // /////////////////////////////
+        TimerRegistry::instance().start("output save");
         for(auto id_out=0u;id_out<outputVec.size();id_out++)
         {
             outputVec.at(id_out)->save((float) index);
         }
+        TimerRegistry::instance().stop();
 
       }
 
@@ -353,6 +416,7 @@ int main(int argc, char *argv[])
 
 
     // /////////////////////////////
+    writeTimingReport(arguments.timingReportFile);
     exit(EXIT_SUCCESS);
 }
 
@@ -396,3 +460,118 @@ Sensor* parseSensors (const std::string fileName)
   return xmlRoot;
 
 }
+
+void setInitialFields(WINDSInputData* WID, WINDSGeneralData* WGD, int index, int solveType)
+{
+    // Reset icellflag values
+    for (int k = 0; k < WGD->nz-2; k++)
+    {
+        for (int j = 0; j < WGD->ny-1; j++)
+        {
+            for (int i = 0; i < WGD->nx-1; i++)
+            {
+                int icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);
+                if (WGD->icellflag[icell_cent] != 0 && WGD->icellflag[icell_cent] != 2 && WGD->icellflag[icell_cent] != 8 && WGD->icellflag[icell_cent] != 7)
+                {
+                  WGD->icellflag[icell_cent] = 1;
+                }
+            }
+        }
+    }
+
+    // Create initial velocity field from the new sensors
+    WID->metParams->sensors[0]->inputWindProfile(WID, WGD, index, solveType);
+
+    if (WGD->parameterizationCache != nullptr)
+    {
+        WGD->parameterizationCache->startStep();
+    }
+
+    // ///////////////////////////////////////
+    // Canopy Vegetation Parameterization
+    // ///////////////////////////////////////
+    TimerRegistry::instance().start("canopy vegetation");
+    for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
+    {
+        // for now this does the canopy stuff for us
+        WGD->allBuildingsV[WGD->building_id[i]]->canopyVegetation(WGD);
+    }
+    TimerRegistry::instance().stop();
+
+    ///////////////////////////////////////////
+    //   Upwind Cavity Parameterization     ///
+    ///////////////////////////////////////////
+    if (WID->simParams->upwindCavityFlag > 0)
+    {
+        ScopedTimer timer("upwind cavity");
+        std::cout << "Applying upwind cavity parameterization...\n";
+        BuildingScheduler::apply(Building::UpwindCavity, WID, WGD);
+        std::cout << "Upwind cavity parameterization done...\n";
+    }
+
+    //////////////////////////////////////////////////
+    //   Far-Wake and Cavity Parameterizations     ///
+    //////////////////////////////////////////////////
+    if (WID->simParams->wakeFlag > 0)
+    {
+        ScopedTimer timer("wake");
+        std::cout << "Applying wake behind building parameterization...\n";
+        BuildingScheduler::apply(Building::Wake, WID, WGD);
+        std::cout << "Wake behind building parameterization done...\n";
+    }
+
+    ///////////////////////////////////////////
+    //   Street Canyon Parameterization     ///
+    ///////////////////////////////////////////
+    if (WID->simParams->streetCanyonFlag > 0)
+    {
+        ScopedTimer timer("street canyon");
+        std::cout << "Applying street canyon parameterization...\n";
+        BuildingScheduler::apply(Building::StreetCanyon, WID, WGD);
+        std::cout << "Street canyon parameterization done...\n";
+    }
+
+    ///////////////////////////////////////////
+    //      Sidewall Parameterization       ///
+    ///////////////////////////////////////////
+    if (WID->simParams->sidewallFlag > 0)
+    {
+        ScopedTimer timer("sidewall");
+        std::cout << "Applying sidewall parameterization...\n";
+        BuildingScheduler::apply(Building::Sidewall, WID, WGD);
+        std::cout << "Sidewall parameterization done...\n";
+    }
+
+
+    ///////////////////////////////////////////
+    //      Rooftop Parameterization        ///
+    ///////////////////////////////////////////
+    if (WID->simParams->rooftopFlag > 0)
+    {
+        ScopedTimer timer("rooftop");
+        std::cout << "Applying rooftop parameterization...\n";
+        BuildingScheduler::apply(Building::Rooftop, WID, WGD);
+        std::cout << "Rooftop parameterization done...\n";
+    }
+
+    WGD->wall->setVelocityZero (WGD);
+
+    if (WGD->parameterizationCache != nullptr)
+    {
+        const ParameterizationCache *cache = WGD->parameterizationCache;
+        std::cout << "Parameterization cache: " << cache->replayed << " of " << cache->replayed + cache->recomputed
+                  << " building parameterizations replayed at time step " << index << " (" << cache->savedTime
+                  << " s saved, " << cache->totalSavedTime << " s in total)\n";
+    }
+}
+
+void writeTimingReport(const std::string fileName)
+{
+    if (fileName != "")
+    {
+        if (TimerRegistry::instance().writeJSON(fileName))
+        {
+            std::cout << "Timing report written to " << fileName << std::endl;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * Benchmark of the construction of the terrain BVH.
+ *
+ * Triangulates synthetic height fields of increasing size and builds
+ * their BVH with 1, 2, 4, ... threads (up to the OpenMP maximum). It
+ * reports the build time against the number of triangles and threads,
+ * and checks that the tree found with every thread count gives the
+ * same heights as the one built on a single thread.
+ *
+ * qesWinds does not build a BVH (the terrain heights come from the DEM
+ * node grid), so the parallel build is measured here only.
+ *
+ * usage: bvhBuildBench [smallest grid size] [largest grid size]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "BVH.h"
+
+int main(int argc, char *argv[])
+{
+    int minSize = (argc > 1) ? atoi(argv[1]) : 256;
+    int maxSize = (argc > 2) ? atoi(argv[2]) : 1024;
+
+    int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+
+    std::cout << "BVH build benchmark: grids of " << minSize << " to " << maxSize
+              << " cells, up to " << maxThreads << " threads" << std::endl;
+    std::cout << std::setw(12) << "triangles" << std::setw(10) << "threads"
+              << std::setw(12) << "build (s)" << std::setw(10) << "speedup"
+              << std::setw(10) << "nodes" << std::endl;
+
+    for (int size = minSize; size <= maxSize; size *= 2)
+    {
+        // Two triangles per cell, as in DTEHeightField
+        TrianglePool tris;
+        tris.reserve((size+1)*(size+1), 2*size*size);
+        for (int j = 0; j <= size; j++)
+        {
+            for (int i = 0; i <= size; i++)
+            {
+                float x = i, y = j;
+                tris.addVertex(x, y, 10.0f*sinf(0.011f*x)*cosf(0.017f*y));
+            }
+        }
+        for (int j = 0; j < size; j++)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                int v00 = i + j*(size+1);
+                tris.addTriangle(v00, v00+1, v00+size+1);
+                tris.addTriangle(v00+size+1, v00+1, v00+size+2);
+            }
+        }
+
+        std::vector<float> reference;
+        double serialTime = 0.0;
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#endif
+            auto start = std::chrono::high_resolution_clock::now();
+            BVH *bvh = BVH::createBVH(tris);
+            auto finish = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = finish - start;
+            if (threads == 1)
+                serialTime = elapsed.count();
+
+            // Heights on the corners and centres of the cells along the diagonal
+            std::vector<float> heights;
+            for (int i = 0; i < size; i++)
+            {
+                heights.push_back(bvh->heightToTri(i, i));
+                heights.push_back(bvh->heightToTri(i + 0.5f, i + 0.25f));
+            }
+            if (threads == 1)
+                reference = heights;
+            else if (heights != reference)
+                std::cerr << "Error: the tree built with " << threads << " threads differs" << std::endl;
+
+            std::cout << std::setw(12) << tris.numTriangles() << std::setw(10) << threads
+                      << std::setw(12) << std::fixed << std::setprecision(3) << elapsed.count()
+                      << std::setw(10) << std::setprecision(2) << serialTime/elapsed.count()
+                      << std::setw(10) << bvh->getNodeCount() << std::endl;
+            delete bvh;
+        }
+    }
+
+    return 0;
+}
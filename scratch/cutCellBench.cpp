@@ -0,0 +1,100 @@
+/*
+ * Benchmark of the generation of the terrain cut-cells.
+ *
+ * Loads a DEM (by default the GaussianHill DEM of the GaussianHill.xml
+ * case: 200 x 200 x 200 cells of 1 m) and sets the cells of the domain
+ * with DTEHeightField::setCells on 1, 2, 4, ... threads (up to the
+ * OpenMP maximum). It reports the time and the speedup against one
+ * thread and the memory of the cut-cell store, and checks that the
+ * cut-cells are the same on every thread count.
+ *
+ * usage: cutCellBench [DEM file] [nx] [ny] [nz] [cell size]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "DTEHeightField.h"
+
+int main(int argc, char *argv[])
+{
+    std::string demFile = (argc > 1) ? argv[1] : "../data/GISFiles/GaussianHill_200x200.tiff";
+    int domainX = (argc > 2) ? atoi(argv[2]) : 200;
+    int domainY = (argc > 3) ? atoi(argv[3]) : 200;
+    int domainZ = (argc > 4) ? atoi(argv[4]) : 200;
+    float cellSize = (argc > 5) ? atof(argv[5]) : 1.0;
+
+    DTEHeightField heightField(demFile, cellSize, cellSize, 0.0, 0.0, 0, 0.0, 0.0, domainX, domainY);
+    Vector3<int> domain(domainX, domainY, domainZ);
+    Vector3<float> grid(cellSize, cellSize, cellSize);
+    heightField.setDomain(&domain, &grid);
+
+    // Staggered grid of WINDSGeneralData, with a uniform vertical grid
+    int nx = domainX + 1;
+    int ny = domainY + 1;
+    int nz = domainZ + 2;
+    std::vector<float> dz_array(nz-1, cellSize);
+    std::vector<float> z_face(nz-1, 0.0);
+    for (int k = 1; k < nz-1; k++)
+    {
+        z_face[k] = z_face[k-1] + dz_array[k];
+    }
+
+    int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+
+    std::cout << "Cut-cell benchmark: " << demFile << ", " << domainX << " x " << domainY << " x " << domainZ
+              << " cells, up to " << maxThreads << " threads" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(12) << "time (s)" << std::setw(10) << "speedup"
+              << std::setw(12) << "cut-cells" << std::setw(12) << "store (MB)" << std::endl;
+
+    std::vector<long> reference;
+    double serialTime = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        CutCells cutCells;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        heightField.setCells(cutCells, nx, ny, nz, cellSize, cellSize, dz_array, z_face, 0.0, 0.0);
+        auto finish = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = finish - start;
+
+        // Index and number of points of each cut-cell
+        std::vector<long> cells;
+        for (long c = 0; c < cutCells.numCutCells(); c++)
+        {
+            cells.push_back(cutCells.getCellId(c));
+            cells.push_back(cutCells.getTerrainPoints(c).size());
+        }
+
+        if (threads == 1)
+        {
+            serialTime = elapsed.count();
+            reference = cells;
+        }
+        else if (cells != reference)
+        {
+            std::cerr << "Error: the cut-cells found with " << threads << " threads differ" << std::endl;
+        }
+
+        std::cout << std::setw(10) << threads << std::setw(12) << std::fixed << std::setprecision(3) << elapsed.count()
+                  << std::setw(10) << std::setprecision(2) << serialTime/elapsed.count()
+                  << std::setw(12) << cutCells.numCutCells()
+                  << std::setw(12) << std::setprecision(1) << cutCells.memoryUsage()/1.0e6 << std::endl;
+    }
+
+    heightField.closeScanner();
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Checks the key of the geometry cache: parsing the same input again
+ * finds the cache file written by the first run, while changing only
+ * the canopies of the XML file misses it, since the canopies change
+ * the numbers of the buildings stored in the cache.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "WINDSInputData.h"
+
+namespace pt = boost::property_tree;
+
+static const char *simulationXML =
+    "<simulationParameters>"
+    "  <domain>20 20 20</domain>"
+    "  <cellSize>1.0 1.0 1.0</cellSize>"
+    "  <geometryCache>%DIR%</geometryCache>"
+    "</simulationParameters>"
+    "<buildings>"
+    "  <wallRoughness>0.1</wallRoughness>"
+    "  <numBuildings>1</numBuildings>"
+    "  <numPolygonNodes>0</numPolygonNodes>"
+    "  <rectangularBuilding>"
+    "    <height>5.0</height><baseHeight>0</baseHeight>"
+    "    <xStart>8.0</xStart><yStart>8.0</yStart>"
+    "    <length>4.0</length><width>4.0</width>"
+    "    <buildingRotation>0.0</buildingRotation>"
+    "  </rectangularBuilding>"
+    "</buildings>";
+
+static const char *canopyXML =
+    "<canopies>"
+    "  <num_canopies>1</num_canopies>"
+    "  <canopy>"
+    "    <attenuationCoefficient>1.97</attenuationCoefficient>"
+    "    <height>3.0</height><baseHeight>0</baseHeight>"
+    "    <xStart>2.0</xStart><yStart>2.0</yStart>"
+    "    <length>4.0</length><width>4.0</width>"
+    "    <canopyRotation>0.0</canopyRotation>"
+    "  </canopy>"
+    "</canopies>";
+
+WINDSInputData* parseInput(const std::string &dir, bool withCanopy)
+{
+    std::string xml = simulationXML;
+    xml.replace(xml.find("%DIR%"), 5, dir);
+    if (withCanopy) {
+        xml += canopyXML;
+    }
+
+    std::istringstream input(xml);
+    pt::ptree tree;
+    pt::read_xml(input, tree);
+
+    WINDSInputData* WID = new WINDSInputData();
+    WID->parseTree(tree);
+    return WID;
+}
+
+int main(int argc, char *argv[])
+{
+    char dirTemplate[] = "/tmp/qesGeometryCacheTestXXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr) {
+        std::cerr << "Could not create the cache directory" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::string dir = dirTemplate;
+
+    // First run: nothing cached yet, write the cache file
+    WINDSInputData* first = parseInput(dir, false);
+    GeometryCache* cache = first->simParams->geometryCache;
+    std::vector<int> flags(10, 1);
+    cache->add("icellflag", flags);
+    bool written = cache->write();
+
+    // Same input: the cache file is found
+    WINDSInputData* same = parseInput(dir, false);
+
+    // Same buildings with a canopy added: the cache file is not used
+    WINDSInputData* canopy = parseInput(dir, true);
+
+    bool ok = true;
+    if (!written || first->simParams->geometryCache->isLoaded()) {
+        std::cerr << "FAILED: the first run should write a new cache file" << std::endl;
+        ok = false;
+    }
+    if (!same->simParams->geometryCache->isLoaded()) {
+        std::cerr << "FAILED: the same input should find the cache file" << std::endl;
+        ok = false;
+    }
+    if (canopy->simParams->geometryCache->isLoaded() ||
+        canopy->simParams->geometryCache->getFileName() == cache->getFileName()) {
+        std::cerr << "FAILED: a change of the canopies should miss the cache" << std::endl;
+        ok = false;
+    }
+
+    std::remove(cache->getFileName().c_str());
+    rmdir(dir.c_str());
+
+    if (!ok) {
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "Geometry cache key test passed" << std::endl;
+    exit(EXIT_SUCCESS);
+}
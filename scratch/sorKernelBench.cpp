@@ -0,0 +1,118 @@
+/*
+ * Microbenchmark of the red-black SOR row kernels.
+ *
+ * Runs every kernel supported by the CPU over the same synthetic rows
+ * and reports the throughput in cells per second, along with the
+ * largest difference to the scalar kernel.
+ *
+ * usage: sorKernelBench [row length] [number of rows] [repetitions]
+ */
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+
+#include "SORKernels.h"
+
+int main(int argc, char *argv[])
+{
+    int rowLength = (argc > 1) ? atoi(argv[1]) : 256;
+    int numRows = (argc > 2) ? atoi(argv[2]) : 4096;
+    int reps = (argc > 3) ? atoi(argv[3]) : 50;
+    const float omega = 1.78f;
+
+    // one spare row on each side for the j-neighbors and one spare cell
+    // on each side for the i-neighbors
+    long stride = rowLength + 2;
+    long size = stride*(numRows + 2);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    std::vector<float> other(size), lambda0(size), rr(size);
+    std::vector<float> coef[6];
+    for (long id = 0; id < size; id++)
+    {
+        other[id] = dist(rng);
+        lambda0[id] = dist(rng);
+        rr[id] = 0.01f*dist(rng);
+    }
+    for (int c = 0; c < 6; c++)
+    {
+        coef[c].resize(size);
+        for (long id = 0; id < size; id++)
+        {
+            coef[c][id] = omega*dist(rng)/6.0f;
+        }
+    }
+
+    std::cout << "SOR row kernel benchmark: " << numRows << " rows of " << rowLength
+              << " cells, " << reps << " repetitions" << std::endl;
+
+    std::vector<float> reference;
+    for (int t = SOR_Scalar; t <= SOR_AVX512; t++)
+    {
+        SORKernelType type = (SORKernelType)t;
+        if (!sorKernelSupported(type))
+        {
+            std::cout << "  " << sorKernelName(type) << ": not supported on this CPU" << std::endl;
+            continue;
+        }
+        SORRowKernel kernel = sorKernel(type);
+
+        std::vector<float> lambda = lambda0;
+        float max_error = 0.0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < reps; r++)
+        {
+            for (int row_id = 1; row_id <= numRows; row_id++)
+            {
+                long id = 1 + row_id*stride;
+                SORRow row;
+                row.lambda = lambda.data() + id;
+                row.east = other.data() + id + 1;
+                row.west = other.data() + id - 1;
+                row.north = other.data() + id + stride;
+                row.south = other.data() + id - stride;
+                row.up = other.data() + id + 1 + stride;
+                row.down = other.data() + id - 1 - stride;
+                row.ce = coef[0].data() + id;
+                row.cf = coef[1].data() + id;
+                row.cg = coef[2].data() + id;
+                row.ch = coef[3].data() + id;
+                row.cm = coef[4].data() + id;
+                row.cn = coef[5].data() + id;
+                row.rr = rr.data() + id;
+                row.count = rowLength;
+                max_error = std::max(max_error, kernel(row, omega));
+            }
+        }
+        auto finish = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = finish - start;
+
+        double cells = (double)reps*numRows*rowLength;
+        std::cout << "  " << sorKernelName(type) << ": " << cells/elapsed.count()/1e6
+                  << " Mcells/s (" << elapsed.count() << " s, last max change " << max_error << ")";
+
+        if (type == SOR_Scalar)
+        {
+            reference = lambda;
+        }
+        else
+        {
+            float diff = 0.0;
+            for (long id = 0; id < size; id++)
+            {
+                diff = std::max(diff, std::fabs(lambda[id] - reference[id]));
+            }
+            std::cout << ", max difference to scalar " << diff;
+        }
+        std::cout << std::endl;
+    }
+
+    exit(EXIT_SUCCESS);
+}
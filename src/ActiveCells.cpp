@@ -0,0 +1,93 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#include "ActiveCells.h"
+
+#include "WINDSGeneralData.h"
+
+
+ActiveCells::ActiveCells(const WINDSGeneralData *WGD)
+    : numActive( 0 ),
+      numSkipped( 0 ),
+      nx( WGD->nx ),
+      ny( WGD->ny ),
+      nz( WGD->nz )
+{
+    rowOffset.resize( (ny-1)*(nz-1) + 1 );
+
+    for (int k = 0; k < nz-1; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            rowOffset[j + k*(ny-1)] = spanStart.size();
+
+            bool inSpan = false;
+            for (int i = 0; i < nx-1; i++)
+            {
+                long icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                int flag = WGD->icellflag[icell_cent];
+                bool active = (flag != 0 && flag != 2);
+
+                if (active && !inSpan)
+                {
+                    spanStart.push_back(i);
+                }
+                else if (!active && inSpan)
+                {
+                    spanEnd.push_back(i);
+                }
+                inSpan = active;
+
+                if (active)
+                {
+                    numActive++;
+                }
+                else
+                {
+                    numSkipped++;
+                }
+                if (flag == 7 || flag == 8)
+                {
+                    cutCells.push_back(icell_cent);
+                }
+            }
+            if (inSpan)
+            {
+                spanEnd.push_back(nx-1);
+            }
+        }
+    }
+    rowOffset[(ny-1)*(nz-1)] = spanStart.size();
+}
@@ -0,0 +1,82 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#pragma once
+
+/*
+ * Index of the active (fluid) cells of the domain.
+ *
+ * Each (j,k) row of cells is stored as spans [start, end) of
+ * consecutive cells that are not inside a building or the terrain
+ * (icellflag 0 or 2), so the solvers can skip the solid cells.  The
+ * cut-cells (icellflag 7 or 8) are kept in a separate list.
+ */
+
+#include <vector>
+
+class WINDSGeneralData;
+
+class ActiveCells
+{
+public:
+
+    /*
+     * Builds the index from the cell flags of WGD (after
+     * Wall::defineWalls).
+     */
+    ActiveCells(const WINDSGeneralData *WGD);
+
+    /*
+     * @return first span of row (j,k)
+     */
+    inline int rowBegin(int j, int k) const { return rowOffset[j + k*(ny-1)]; }
+
+    /*
+     * @return one past the last span of row (j,k)
+     */
+    inline int rowEnd(int j, int k) const { return rowOffset[j + k*(ny-1) + 1]; }
+
+    std::vector<int> spanStart;     /**< i of the first cell of each span */
+    std::vector<int> spanEnd;       /**< i one past the last cell of each span */
+    std::vector<long> cutCells;     /**< Indices of the cut-cells (icellflag 7 or 8) */
+
+    long numActive;                 /**< Number of active cells */
+    long numSkipped;                /**< Number of building and terrain cells */
+
+private:
+
+    int nx, ny, nz;
+    std::vector<int> rowOffset;     /**< First span of each row, (ny-1)*(nz-1)+1 entries */
+};
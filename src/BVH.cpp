@@ -33,175 +33,296 @@
 
 #include "BVH.h"
 
-void BVH::mergeSort(std::vector<BVH*>& list, const int type)
+#include <algorithm>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+/*
+ * Area of a box in the xy plane: for the vertical rays cast through
+ * the tree, the chance to hit a box is proportional to it.
+ */
+inline float areaXY(float xmin, float xmax, float ymin, float ymax)
 {
-   if (list.size() <= 1)
-      return;
-
-   std::vector<BVH *> l, r;
-   int midPoint = list.size() / 2;
-   for (int i = 0; i < midPoint; i++)
-      l.push_back(list[i]);
-   for (int i = midPoint; i < list.size(); i++)
-      r.push_back(list[i]);
-
-   mergeSort(l, type);
-   mergeSort(r, type);
-
-   int lSize = l.size(), rSize = r.size();
-   int j = 0, k = 0;
-   for (auto i = 0u; i < list.size(); i++)
-   {
-      if ( j == lSize)
-         list[i] = r[k++];
-      else if ( k == rSize)
-         list[i] = l[j++];
-      else
-      {
-         float lMid, rMid;
-         if (type == 0)
-         {
-            lMid = (l[j]->xmin + l[j]->xmax) / 2.0f;
-            rMid = (r[k]->xmin + r[k]->xmax) / 2.0f;
-         }
-         else
-         {
-            lMid = (l[j]->ymin + l[j]->ymax) / 2.0f;
-            rMid = (r[k]->ymin + r[k]->ymax) / 2.0f;
-         }
-         list[i] = (lMid < rMid ? l[j++] : r[k++]);
-      }
-   }
+   return (xmax - xmin) * (ymax - ymin);
+}
+
+/*
+ * Bin of a centroid coordinate for the binned build
+ */
+inline int binOf(float c, float cmin, float scale, int binCount)
+{
+   int bin = (int)((c - cmin) * scale);
+   return bin < binCount ? bin : binCount - 1;
+}
 
 }
 
-BVH::BVH(BVH* l, BVH* r)
+BVH::BVH(const TrianglePool &tris)
 {
-   leftBox = l;
-   rightBox = r;
-   if (r != 0)
+   int n = tris.numTriangles();
+
+   // Boxes of the triangles (xmin, xmax, ymin, ymax, zmin, zmax)
+   std::vector<float> boxes(6 * n);
+   triIndex.resize(n);
+#pragma omp parallel for schedule(static)
+   for (int i = 0; i < n; i++)
    {
-      xmin = GETMIN(l->xmin, r->xmin);
-      xmax = GETMAX(l->xmax, r->xmax);
-      ymin = GETMIN(l->ymin, r->ymin);
-      ymax = GETMAX(l->ymax, r->ymax);
-      zmin = GETMIN(l->zmin, r->zmin);
-      zmax = GETMAX(l->zmax, r->zmax);
+      float *b = &boxes[6 * i];
+      tris.getBoundaries(i, b[0], b[1], b[2], b[3], b[4], b[5]);
+      triIndex[i] = i;
    }
-   else
+
+   nodes.reserve(n > 0 ? 2 * n / leafSize + 1 : 0);
+   if (n > 0)
+   {
+#pragma omp parallel
+#pragma omp single
+      buildNode(nodes, boxes, 0, n, 0);
+   }
+
+   // Copy of the triangles in the order of the leaves
+   leafTris.resize(n);
+#pragma omp parallel for schedule(static)
+   for (int s = 0; s < n; s++)
    {
-      xmin = l->xmin;
-      xmax = l->xmax;
-      ymin = l->ymin;
-      ymax = l->ymax;
-      zmin = l->zmin;
-      zmax = l->zmax;
+      int i = triIndex[s];
+      LeafTriangle &t = leafTris[s];
+      t.xmin = boxes[6 * i];
+      t.xmax = boxes[6 * i + 1];
+      t.ymin = boxes[6 * i + 2];
+      t.ymax = boxes[6 * i + 3];
+      tris.getCorners(i, t.a, t.b, t.c);
    }
 
-   isLeaf = false;
-   tri = 0;
+   if (nodes.empty())
+   {
+      xmin = xmax = ymin = ymax = zmin = zmax = 0.0f;
+   }
+   else
+   {
+      xmin = nodes[0].xmin;
+      xmax = nodes[0].xmax;
+      ymin = nodes[0].ymin;
+      ymax = nodes[0].ymax;
+      zmin = nodes[0].zmin;
+      zmax = nodes[0].zmax;
+   }
 }
 
-BVH::BVH(Triangle* t)
+void BVH::appendSubtree(std::vector<Node> &tree, const std::vector<Node> &subtree)
 {
-   tri = t;
-   isLeaf = true;
-
-   t->getBoundaries(xmin, xmax, ymin, ymax, zmin, zmax);
-
-   leftBox = rightBox = 0;
+   int base = tree.size();
+   for (size_t i = 0; i < subtree.size(); i++)
+   {
+      Node node = subtree[i];
+      if (node.count == 0)
+         node.offset += base;
+      tree.push_back(node);
+   }
 }
 
-BVH::BVH(std::vector<BVH *> m, int height)
+int BVH::buildNode(std::vector<Node> &tree, const std::vector<float> &boxes, int first, int count, int depth)
 {
-   isLeaf = false;
-   if (m.size() == 1)
+   int nodeIdx = tree.size();
+   tree.push_back(Node());
+
+   // Box of the triangles and box of their centroids
+   Node node;
+   node.xmin = node.ymin = node.zmin = std::numeric_limits<float>::max();
+   node.xmax = node.ymax = node.zmax = -std::numeric_limits<float>::max();
+   float cmin[2] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+   float cmax[2] = {-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+   for (int t = first; t < first + count; t++)
    {
-      leftBox = m[0];
-      rightBox = 0;
-
-      xmin = leftBox->xmin;
-      xmax = leftBox->xmax;
-      ymin = leftBox->ymin;
-      ymax = leftBox->ymax;
-      zmin = leftBox->zmin;
-      zmax = leftBox->zmax;
-
-      tri = 0;
-      return;
+      const float *b = &boxes[6 * triIndex[t]];
+      node.xmin = GETMIN(node.xmin, b[0]);
+      node.xmax = GETMAX(node.xmax, b[1]);
+      node.ymin = GETMIN(node.ymin, b[2]);
+      node.ymax = GETMAX(node.ymax, b[3]);
+      node.zmin = GETMIN(node.zmin, b[4]);
+      node.zmax = GETMAX(node.zmax, b[5]);
+      for (int axis = 0; axis < 2; axis++)
+      {
+         float c = 0.5f * (b[2 * axis] + b[2 * axis + 1]);
+         cmin[axis] = GETMIN(cmin[axis], c);
+         cmax[axis] = GETMAX(cmax[axis], c);
+      }
    }
-   else if (m.size() == 2)
+   node.offset = first;
+   node.count = count;
+
+   if (count <= leafSize || depth >= maxDepth - 1)
    {
-      leftBox = m[0];
-      rightBox = m[1];
-
-      xmin = GETMIN(leftBox->xmin, rightBox->xmin);
-      xmax = GETMAX(leftBox->xmax, rightBox->xmax);
-      ymin = GETMIN(leftBox->ymin, rightBox->ymin);
-      ymax = GETMAX(leftBox->ymax, rightBox->ymax);
-      zmin = GETMIN(leftBox->zmin, rightBox->zmin);
-      zmax = GETMAX(leftBox->zmax, rightBox->zmax);
-
-      tri = 0;
-      return;
+      tree[nodeIdx] = node;
+      return nodeIdx;
    }
 
-   mergeSort(m, height % 2);
-
-
-   std::vector<BVH *> l, r;
-   int midPoint = m.size() / 2;
-   for (int i = 0; i < midPoint; i++)
-      l.push_back(m[i]);
-   for (int i = midPoint; i < m.size(); i++)
-      r.push_back(m[i]);
-
-   leftBox = new BVH(l, height + 1);
-   rightBox = new BVH(r, height + 1);
+   // Binned surface area heuristic over the x and y axes
+   int bestAxis = -1, bestBin = 0;
+   float bestCost = std::numeric_limits<float>::max();
+   for (int axis = 0; axis < 2; axis++)
+   {
+      if (cmax[axis] <= cmin[axis])
+         continue;
+      float scale = binCount / (cmax[axis] - cmin[axis]);
 
-   xmin = GETMIN(leftBox->xmin, rightBox->xmin);
-   xmax = GETMAX(leftBox->xmax, rightBox->xmax);
-   ymin = GETMIN(leftBox->ymin, rightBox->ymin);
-   ymax = GETMAX(leftBox->ymax, rightBox->ymax);
-   zmin = GETMIN(leftBox->zmin, rightBox->zmin);
-   zmax = GETMAX(leftBox->zmax, rightBox->zmax);
+      int binTris[binCount] = {0};
+      float binBox[binCount][4];
+      for (int k = 0; k < binCount; k++)
+      {
+         binBox[k][0] = binBox[k][2] = std::numeric_limits<float>::max();
+         binBox[k][1] = binBox[k][3] = -std::numeric_limits<float>::max();
+      }
+      for (int t = first; t < first + count; t++)
+      {
+         const float *b = &boxes[6 * triIndex[t]];
+         int k = binOf(0.5f * (b[2 * axis] + b[2 * axis + 1]), cmin[axis], scale, binCount);
+         binTris[k]++;
+         binBox[k][0] = GETMIN(binBox[k][0], b[0]);
+         binBox[k][1] = GETMAX(binBox[k][1], b[1]);
+         binBox[k][2] = GETMIN(binBox[k][2], b[2]);
+         binBox[k][3] = GETMAX(binBox[k][3], b[3]);
+      }
 
-   tri = 0;
-}
+      // Area and number of triangles right of each split
+      float rightArea[binCount];
+      int rightTris[binCount];
+      float r[4] = {std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+      int nR = 0;
+      for (int k = binCount - 1; k > 0; k--)
+      {
+         nR += binTris[k];
+         r[0] = GETMIN(r[0], binBox[k][0]);
+         r[1] = GETMAX(r[1], binBox[k][1]);
+         r[2] = GETMIN(r[2], binBox[k][2]);
+         r[3] = GETMAX(r[3], binBox[k][3]);
+         rightTris[k] = nR;
+         rightArea[k] = nR > 0 ? areaXY(r[0], r[1], r[2], r[3]) : 0.0f;
+      }
 
+      // Split after bin k: bins 0..k go left
+      float l[4] = {std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+      int nL = 0;
+      for (int k = 0; k < binCount - 1; k++)
+      {
+         nL += binTris[k];
+         l[0] = GETMIN(l[0], binBox[k][0]);
+         l[1] = GETMAX(l[1], binBox[k][1]);
+         l[2] = GETMIN(l[2], binBox[k][2]);
+         l[3] = GETMAX(l[3], binBox[k][3]);
+         if (nL == 0 || rightTris[k + 1] == 0)
+            continue;
+         float cost = nL * areaXY(l[0], l[1], l[2], l[3]) + rightTris[k + 1] * rightArea[k + 1];
+         if (cost < bestCost)
+         {
+            bestCost = cost;
+            bestAxis = axis;
+            bestBin = k;
+         }
+      }
+   }
 
-BVH* BVH::createBVH(const std::vector<Triangle*> tris)
-{
-   std::vector<BVH *> boxes;
+   // All the centroids are at the same place: nothing to split
+   if (bestAxis < 0)
+   {
+      tree[nodeIdx] = node;
+      return nodeIdx;
+   }
 
-   for (int i = 0; i < tris.size(); i++)
+   // Keep a leaf when testing the triangles is cheaper than one more level
+   float area = areaXY(node.xmin, node.xmax, node.ymin, node.ymax);
+   if (count <= maxLeafSize && bestCost + area >= count * area)
    {
-      BVH* b = new BVH(tris[i]);
-      boxes.push_back(b);
+      tree[nodeIdx] = node;
+      return nodeIdx;
    }
 
-   BVH* root = new BVH(boxes, 0);
-   return root;
-}
+   float scale = binCount / (cmax[bestAxis] - cmin[bestAxis]);
+   float axisMin = cmin[bestAxis];
+   int *mid = std::partition(&triIndex[first], &triIndex[first] + count,
+                             [&](int i) {
+                                const float *b = &boxes[6 * i];
+                                float c = 0.5f * (b[2 * bestAxis] + b[2 * bestAxis + 1]);
+                                return binOf(c, axisMin, scale, binCount) <= bestBin;
+                             });
+   int nLeft = mid - &triIndex[first];
 
-float BVH::heightToTri(float x, float y)
-{
-   if (isLeaf)
+   node.count = 0;
+   if (count < taskSize)
    {
-      return tri->getHeightTo(x, y);
+      buildNode(tree, boxes, first, nLeft, depth + 1);
+      node.offset = buildNode(tree, boxes, first + nLeft, count - nLeft, depth + 1);
    }
    else
    {
-      float toL = -1.0f, toR = -1.0f;
+      // The children work on separate ranges of triIndex: build them
+      // in separate lists and append them in depth-first order
+      std::vector<Node> left, right;
+#pragma omp task shared(left, boxes)
+      buildNode(left, boxes, first, nLeft, depth + 1);
+#pragma omp task shared(right, boxes)
+      buildNode(right, boxes, first + nLeft, count - nLeft, depth + 1);
+#pragma omp taskwait
+
+      appendSubtree(tree, left);
+      node.offset = tree.size();
+      appendSubtree(tree, right);
+   }
+   tree[nodeIdx] = node;
+
+   return nodeIdx;
+}
 
-      if (leftBox && leftBox->xmin <= x && leftBox->xmax >= x &&
-          leftBox->ymin <= y && leftBox->ymax >= y)
-         toL = leftBox->heightToTri(x, y);
 
-      if (rightBox && rightBox->xmin <= x && rightBox->xmax >= x &&
-          rightBox->ymin <= y && rightBox->ymax >= y)
-         toR = rightBox->heightToTri(x, y);
+BVH* BVH::createBVH(const TrianglePool &tris)
+{
+   return new BVH(tris);
+}
 
-      return toL > toR ? toL : toR;
+float BVH::heightToTri(float x, float y) const
+{
+   float height = -1.0f;
+   if (nodes.empty())
+      return height;
+
+   int stack[maxDepth];
+   int top = 0;
+   int n = 0;
+   while (true)
+   {
+      const Node &node = nodes[n];
+      if (node.xmin <= x && node.xmax >= x && node.ymin <= y && node.ymax >= y)
+      {
+         if (node.count == 0)
+         {
+            // Left child first, right child later
+            stack[top++] = node.offset;
+            n = n + 1;
+            continue;
+         }
+
+         for (int s = node.offset; s < node.offset + node.count; s++)
+         {
+            const LeafTriangle &t = leafTris[s];
+            if (t.xmin <= x && t.xmax >= x && t.ymin <= y && t.ymax >= y)
+            {
+               float h = Triangle::getHeightTo(t.a, t.b, t.c, x, y);
+               height = h > height ? h : height;
+            }
+         }
+      }
+
+      if (top == 0)
+         break;
+      n = stack[--top];
    }
+
+   return height;
 }
@@ -36,11 +36,25 @@
 /*
  * This class is a Bounding Volume Hierarchy data structure. This
  * organizes Triangles spacially allowing for fast access based on location.
+ *
+ * The nodes are stored in one array in depth-first order (the left
+ * child of a node follows it, the node keeps the index of its right
+ * child) and the leaves refer to a range of triangles, copied in the
+ * order of the leaves. The tree is built with a binned surface area
+ * heuristic and queried with an explicit stack.
+ *
+ * The winds pipeline does not use it: the terrain heights are sampled
+ * from the DEM node grid (DTEHeightField::getHeight). The tree is only
+ * built by Mesh, for ray queries, and by scratch/bvhBuildBench.
+ *
+ * With OpenMP, the subtrees of large nodes are built as parallel tasks
+ * and joined in the same depth-first order, so the tree does not depend
+ * on the number of threads.
  */
 
 #include <vector>
 
-#include "Triangle.h"
+#include "TrianglePool.h"
 
 #define GETMIN(x,y) ( (x) < (y) ? (x) : (y))
 #define GETMAX(x,y) ( (x) > (y) ? (x) : (y))
@@ -52,49 +66,68 @@ using std::vector;
 class BVH
 {
 private:
-	BVH* leftBox;
-	BVH* rightBox;
-
-	bool isLeaf;
-	Triangle* tri;
-
 
 	/*
-	 * This function sorts Bounding Boxes by recursively dividing them
-	 * apart, and then putting them in order and then merging the lists.
-	 *
-	 * @param list -the list of bounding boxes that should be sorted
-	 * @param type -identifier for what dimension the boxes are being sorted by
+	 * Node of the tree. For a leaf, offset is the first triangle and
+	 * count the number of triangles. For an inner node, count is 0 and
+	 * offset is the index of the right child.
 	 */
-	static void mergeSort(std::vector<BVH *>& list, const int type);
+	struct Node
+	{
+		float xmin, xmax, ymin, ymax, zmin, zmax;
+		int offset;
+		int count;
+	};
 
-public:
-	float xmin, xmax, ymin, ymax, zmin, zmax;
+	/*
+	 * Triangle of a leaf with its box in the xy plane
+	 */
+	struct LeafTriangle
+	{
+		float xmin, xmax, ymin, ymax;
+		float a[3], b[3], c[3];
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> triIndex;             // Index in the pool of the triangles of the leaves
+	std::vector<LeafTriangle> leafTris;    // Triangles of the leaves, in the same order
+
+	static const int binCount = 16;        // Number of bins of the SAH build
+	static const int leafSize = 4;         // Nodes with fewer triangles are always leaves
+	static const int maxLeafSize = 16;     // Nodes with more triangles are always split
+	static const int maxDepth = 64;        // Size of the traversal stack
+	static const int taskSize = 32768;     // Nodes with more triangles build their children as tasks
 
 	/*
-	 * Creates a bounding box encasing two child bounding boxes
+	 * Builds the subtree of the triangles triIndex[first..first+count)
+	 * at the end of a node list and returns the index of its root node.
 	 *
-	 * @param l -left child box
-	 * @param r -right child box
+	 * @param tree -the node list
+	 * @param boxes -boxes of the input triangles, 6 values each
+	 * @param first -first triangle of the node in triIndex
+	 * @param count -number of triangles of the node
+	 * @param depth -depth of the node
 	 */
-	BVH(BVH* l, BVH* r);
+	int buildNode(std::vector<Node> &tree, const std::vector<float> &boxes, int first, int count, int depth);
 
 	/*
-	 * Creates a bounding box encasing a triangle, this marks the box
-	 * as a leaf meaning it is at the bottom of the tree.
+	 * Appends the nodes of a subtree built in its own list, shifting
+	 * the indices of the right children.
 	 *
-	 * @param t -The triangle to be put in the heirarchy
+	 * @param tree -the node list
+	 * @param subtree -nodes of the subtree
 	 */
-	BVH(Triangle* t);
+	static void appendSubtree(std::vector<Node> &tree, const std::vector<Node> &subtree);
+
+public:
+	float xmin, xmax, ymin, ymax, zmin, zmax;
 
 	/*
-	 * Creates a bounding volume heirarchy from a list of bounding boxes.
-	 * height is used to determine the spacial ordering.
+	 * Creates a bounding volume heirarchy from a pool of triangles.
 	 *
-	 * @param m -list of bounding boxes
-	 * @param height -current depth in the tree
+	 * @param tris -triangles that will be placed in the structure
 	 */
-	BVH(std::vector<BVH *> m, int height);
+	BVH(const TrianglePool &tris);
 
 	/*
 	 * Takes a point in the x y plane and finds what triangle is directly above
@@ -104,13 +137,21 @@ public:
 	 * @param y -y position
 	 * @return distance from the point to the triangle directly above it
 	 */
-	float heightToTri(float x, float y);
+	float heightToTri(float x, float y) const;
+
+	/*
+	 * Returns the number of nodes of the tree
+	 */
+	int getNodeCount() const
+	{
+		return nodes.size();
+	}
 
 	/*
 	 *method that creates a BVA structure from a vector of models
 	 *
-	 * @param tris -list of triangles that will be placed in the structure
+	 * @param tris -triangles that will be placed in the structure
 	 */
-	static BVH* createBVH(const std::vector<Triangle*> tris);
+	static BVH* createBVH(const TrianglePool &tris);
 
 };
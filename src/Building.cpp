@@ -0,0 +1,141 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "Building.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "WINDSGeneralData.h"
+
+
+void Building::setFaces(const WINDSGeneralData* WGD)
+{
+  faces.clear();
+  faceCells.clear();
+  if (polygonVertices.size() < 2)
+  {
+    return;
+  }
+
+  float cross_dir, x_down, y_down;
+  for (auto j_id = 0; j_id < polygonVertices.size()-1; j_id++)
+  {
+    Face face;
+    cross_dir = atan2(polygonVertices[j_id+1].y_poly-polygonVertices[j_id].y_poly,
+                      polygonVertices[j_id+1].x_poly-polygonVertices[j_id].x_poly)+0.5*M_PI;
+    if (cross_dir > M_PI+0.001)
+    {
+      cross_dir -= 2*M_PI;
+    }
+    face.cross_dir = cross_dir;
+    face.x_ave = 0.5*(polygonVertices[j_id+1].x_poly+polygonVertices[j_id].x_poly);
+    face.y_ave = 0.5*(polygonVertices[j_id+1].y_poly+polygonVertices[j_id].y_poly);
+    face.segment_length = sqrt(pow(polygonVertices[j_id+1].x_poly-polygonVertices[j_id].x_poly, 2.0)
+                               +pow(polygonVertices[j_id+1].y_poly-polygonVertices[j_id].y_poly, 2.0));
+    faces.push_back(face);
+
+    // Cells around the face, tested with the same expressions as the
+    // street canyon parameterization
+    float margin = 0.75*WGD->dxy;
+    int i_min = floor((std::min(polygonVertices[j_id].x_poly, polygonVertices[j_id+1].x_poly)-margin)/WGD->dx-0.5)-1;
+    int i_max = ceil((std::max(polygonVertices[j_id].x_poly, polygonVertices[j_id+1].x_poly)+margin)/WGD->dx-0.5)+1;
+    int j_min = floor((std::min(polygonVertices[j_id].y_poly, polygonVertices[j_id+1].y_poly)-margin)/WGD->dy-0.5)-1;
+    int j_max = ceil((std::max(polygonVertices[j_id].y_poly, polygonVertices[j_id+1].y_poly)+margin)/WGD->dy-0.5)+1;
+    for (auto j = j_min; j <= j_max; j++)
+    {
+      for (auto i = i_min; i <= i_max; i++)
+      {
+        x_down = ((i+0.5)*WGD->dx-face.x_ave)*cos(cross_dir) + ((j+0.5)*WGD->dy-face.y_ave)*sin(cross_dir);
+        y_down = -((i+0.5)*WGD->dx-face.x_ave)*sin(cross_dir) + ((j+0.5)*WGD->dy-face.y_ave)*cos(cross_dir);
+        if (abs(x_down) < 0.75*WGD->dxy && abs(y_down) <= 0.5*face.segment_length)
+        {
+          faceCells.push_back({i, j, (int)j_id});
+        }
+      }
+    }
+  }
+
+  // Keep the first face of each cell
+  std::sort(faceCells.begin(), faceCells.end(), [](const FaceCell &a, const FaceCell &b) {
+      return a.j < b.j || (a.j == b.j && (a.i < b.i || (a.i == b.i && a.face < b.face)));
+    });
+  faceCells.erase(std::unique(faceCells.begin(), faceCells.end(), [](const FaceCell &a, const FaceCell &b) {
+      return a.i == b.i && a.j == b.j;
+    }), faceCells.end());
+}
+
+int Building::findFace(int i, int j) const
+{
+  auto cell = std::lower_bound(faceCells.begin(), faceCells.end(), FaceCell{i, j, 0},
+                               [](const FaceCell &a, const FaceCell &b) {
+                                 return a.j < b.j || (a.j == b.j && a.i < b.i);
+                               });
+  if (cell != faceCells.end() && cell->i == i && cell->j == j)
+  {
+    return cell->face;
+  }
+  return -1;
+}
+
+void Building::CellBox::add(int i0, int i1, int j0, int j1, int k0, int k1)
+{
+  if (empty())
+  {
+    i_min = i0;
+    i_max = i1;
+    j_min = j0;
+    j_max = j1;
+    k_min = k0;
+    k_max = k1;
+    return;
+  }
+  i_min = std::min(i_min, i0);
+  i_max = std::max(i_max, i1);
+  j_min = std::min(j_min, j0);
+  j_max = std::max(j_max, j1);
+  k_min = std::min(k_min, k0);
+  k_max = std::max(k_max, k1);
+}
+
+void Building::CellBox::addPoint(float x, float y, float dx, float dy, int k0, int k1)
+{
+  // Indices far outside of any domain, that cannot overflow
+  const float far = 1.0e8;
+  float fi = x/dx, fj = y/dy;
+  int i0 = std::isnan(fi) ? -far : floor(std::max(std::min(fi, far), -far));
+  int i1 = std::isnan(fi) ? far : i0;
+  int j0 = std::isnan(fj) ? -far : floor(std::max(std::min(fj, far), -far));
+  int j1 = std::isnan(fj) ? far : j0;
+  add(i0-2, i1+2, j0-2, j1+2, k0, k1);
+}
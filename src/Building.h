@@ -37,6 +37,8 @@
  * This class is an abstract representation of a building. It holds
  * the basic information and functions that every building should have.
 */
+#include <vector>
+
 #include "util/ParseInterface.h"
 #include "PolygonVertex.h"
 //#include "CutVertex.h"
@@ -87,6 +89,83 @@ public:
 
 	std::vector <polyVert> polygonVertices;
 
+	/*
+	 * Face of the building: the segment between two consecutive
+	 * vertices of polygonVertices
+	 */
+	struct Face
+	{
+		float cross_dir;				// Direction perpendicular to the face
+		float x_ave, y_ave;				// Center of the face
+		float segment_length;			// Face length
+	};
+	std::vector<Face> faces;
+
+	/*
+	 * Cell whose center is next to a face (see findFace)
+	 */
+	struct FaceCell
+	{
+		int i, j;
+		int face;						// First face next to the center of the cell
+	};
+	std::vector<FaceCell> faceCells;	// Sorted by j and i
+
+	/*
+	 * Parameterizations applied building by building, in the order of
+	 * the effective heights (see BuildingScheduler)
+	 */
+	enum Parameterization
+	{
+		UpwindCavity,
+		Wake,
+		StreetCanyon,
+		Sidewall,
+		Rooftop
+	};
+
+	/*
+	 * Box of (i, j, k) indices of cells and faces, empty when a min is
+	 * larger than its max
+	 */
+	struct CellBox
+	{
+		int i_min, i_max, j_min, j_max, k_min, k_max;
+
+		CellBox()
+			: i_min(1), i_max(0), j_min(1), j_max(0), k_min(1), k_max(0)
+		{
+		}
+
+		bool empty() const
+		{
+			return i_min > i_max || j_min > j_max || k_min > k_max;
+		}
+
+		bool contains(int i, int j, int k) const
+		{
+			return i >= i_min && i <= i_max && j >= j_min && j <= j_max && k >= k_min && k <= k_max;
+		}
+
+		bool overlaps(const CellBox &box) const
+		{
+			return i_min <= box.i_max && box.i_min <= i_max && j_min <= box.j_max && box.j_min <= j_max &&
+				k_min <= box.k_max && box.k_min <= k_max;
+		}
+
+		/*
+		 * Extends the box to the given ranges of indices
+		 */
+		void add(int i0, int i1, int j0, int j1, int k0, int k1);
+
+		/*
+		 * Extends the box to the cells of layers k0 to k1 within two
+		 * cells of the point (x, y), whatever the rounding of its
+		 * indices (a NaN coordinate gives the whole range)
+		 */
+		void addPoint(float x, float y, float dx, float dy, int k0, int k1);
+	};
+
     Building()
     {
     }
@@ -132,7 +211,48 @@ public:
 		{
 		}
 
+    /*
+     * Gives the face (i, j, k) of the velocity at the centroid of the
+     * roof, from which the parameterizations find the wind direction.
+     * Returns false if the building has no parameterization.
+     */
+    virtual bool roofCentroid (int &i, int &j, int &k) const
+    {
+      return false;
+    }
+
+    /*
+     * Prepares a parameterization of the building for the velocity
+     * field, and sets box to the cells and faces that it may read or
+     * write when applied (only the velocity at the roof centroid must
+     * not change in between).
+     */
+    virtual void prepareParameterization (Parameterization p, const WINDSInputData* WID, WINDSGeneralData* WGD, CellBox &box)
+    {
+    }
+
+    /*
+     * Applies a parameterization prepared by prepareParameterization.
+     */
+    virtual void applyParameterization (Parameterization p, const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id)
+    {
+    }
+
     virtual void NonLocalMixing (WINDSGeneralData* WGD, TURBGeneralData* TGD,int buidling_id)
     {
     }
+
+    /*
+     * Computes the faces of the building and the index of the cells
+     * next to them, once the vertices are in the domain coordinates.
+     */
+    void setFaces (const WINDSGeneralData* WGD);
+
+    /*
+     * Returns the first face next to the center of cell (i, j), -1 if
+     * there is none. A face is next to a point when the point is less
+     * than 0.75 cells away from the line of the face and projects on
+     * the face (as in the street canyon parameterization).
+     */
+    int findFace (int i, int j) const;
 };
@@ -0,0 +1,265 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "BuildingScheduler.h"
+
+#include <algorithm>
+
+#include "WINDSInputData.h"
+#include "WINDSGeneralData.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+void BuildingScheduler::apply(Building::Parameterization p, const WINDSInputData *WID, WINDSGeneralData *WGD)
+{
+    // The zones of the parameterization cache are found with the boxes
+    bool batches = (WGD->parameterizationCache != nullptr);
+#ifdef _OPENMP
+    batches = batches || omp_get_max_threads() > 1;
+#endif
+    if (batches)
+    {
+        BuildingScheduler(p, WID, WGD).run();
+        return;
+    }
+
+    for (size_t i = 0; i < WGD->allBuildingsV.size(); i++)
+    {
+        Building *building = WGD->allBuildingsV[WGD->building_id[i]];
+        switch (p)
+        {
+        case Building::UpwindCavity:
+            building->upwindCavity(WID, WGD);
+            break;
+        case Building::Wake:
+            building->polygonWake(WID, WGD, WGD->building_id[i]);
+            break;
+        case Building::StreetCanyon:
+            building->streetCanyon(WGD);
+            break;
+        case Building::Sidewall:
+            building->sideWall(WID, WGD);
+            break;
+        case Building::Rooftop:
+            building->rooftop(WID, WGD);
+            break;
+        }
+    }
+}
+
+
+BuildingScheduler::BuildingScheduler(Building::Parameterization p, const WINDSInputData *WID, WINDSGeneralData *WGD)
+    : m_p( p ),
+      m_WID( WID ),
+      m_WGD( WGD ),
+      nx( WGD->nx ),
+      ny( WGD->ny ),
+      nz( WGD->nz )
+{
+    m_tilesX = (nx + tileSize-1) / tileSize;
+    m_tilesY = (ny + tileSize-1) / tileSize;
+    m_tiles.resize( m_tilesX * m_tilesY );
+}
+
+
+void BuildingScheduler::run()
+{
+    const WINDSInputData *WID = m_WID;
+    WINDSGeneralData *WGD = m_WGD;
+    for (size_t n = 0; n < WGD->building_id.size(); n++)
+    {
+        int id = WGD->building_id[n];
+        int i, j, k;
+        if (!WGD->allBuildingsV[id]->roofCentroid(i, j, k))
+        {
+            continue;
+        }
+
+        // The velocity at the roof centroid must be final
+        if (isWaiting(i, j, k))
+        {
+            flush();
+        }
+
+        Building::CellBox box;
+        WGD->allBuildingsV[id]->prepareParameterization(m_p, WID, WGD, box);
+        box.add(i, i, j, j, k, k);
+        if (WGD->parameterizationCache != nullptr)
+        {
+            int icell_face = i + j*nx + k*nx*ny;
+            WGD->parameterizationCache->prepare(m_p, id, WGD->u0[icell_face], WGD->v0[icell_face], box);
+        }
+        add(id, box);
+    }
+    flush();
+}
+
+
+void BuildingScheduler::add(int id, Building::CellBox box)
+{
+    wrap(box);
+
+    int batch = 0;
+    int n = m_ids.size();
+    for (int tj = box.j_min/tileSize; tj <= box.j_max/tileSize; tj++)
+    {
+        for (int ti = box.i_min/tileSize; ti <= box.i_max/tileSize; ti++)
+        {
+            std::vector<int> &tile = m_tiles[ti + tj*m_tilesX];
+            for (size_t t = 0; t < tile.size(); t++)
+            {
+                int w = tile[t];
+                if (m_seen[w] != n)
+                {
+                    m_seen[w] = n;
+                    if (m_boxes[w].overlaps(box))
+                    {
+                        batch = std::max(batch, m_batches[w]+1);
+                    }
+                }
+            }
+            tile.push_back(n);
+        }
+    }
+
+    m_ids.push_back(id);
+    m_boxes.push_back(box);
+    m_batches.push_back(batch);
+    m_seen.push_back(-1);
+    m_numBatches = std::max(m_numBatches, batch+1);
+}
+
+
+bool BuildingScheduler::isWaiting(int i, int j, int k) const
+{
+    if (i < 0 || i >= nx || j < 0 || j >= ny)
+    {
+        return !m_ids.empty();
+    }
+
+    const std::vector<int> &tile = m_tiles[i/tileSize + (j/tileSize)*m_tilesX];
+    for (size_t t = 0; t < tile.size(); t++)
+    {
+        if (m_boxes[tile[t]].contains(i, j, k))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void BuildingScheduler::flush()
+{
+    // Waiting buildings of each batch, in the order of building_id
+    std::vector<int> first(m_numBatches+1, 0);
+    for (size_t w = 0; w < m_ids.size(); w++)
+    {
+        first[m_batches[w]+1]++;
+    }
+    for (int b = 0; b < m_numBatches; b++)
+    {
+        first[b+1] += first[b];
+    }
+    std::vector<int> order(m_ids.size());
+    std::vector<int> next(first.begin(), first.end()-1);
+    for (size_t w = 0; w < m_ids.size(); w++)
+    {
+        order[next[m_batches[w]]++] = w;
+    }
+
+    for (int b = 0; b < m_numBatches; b++)
+    {
+#pragma omp parallel for schedule(dynamic)
+        for (int w = first[b]; w < first[b+1]; w++)
+        {
+            int id = m_ids[order[w]];
+            if (m_WGD->parameterizationCache != nullptr)
+            {
+                m_WGD->parameterizationCache->apply(m_p, id, m_WID, m_WGD);
+            }
+            else
+            {
+                m_WGD->allBuildingsV[id]->applyParameterization(m_p, m_WID, m_WGD, id);
+            }
+        }
+    }
+
+    m_ids.clear();
+    m_boxes.clear();
+    m_batches.clear();
+    m_seen.clear();
+    m_numBatches = 0;
+    for (size_t t = 0; t < m_tiles.size(); t++)
+    {
+        m_tiles[t].clear();
+    }
+}
+
+
+void BuildingScheduler::wrap(Building::CellBox &box) const
+{
+    // The cells (nx-1 per row) and the faces (nx per row) out of a row
+    // are in the previous or next rows
+    if (box.i_min < 0 || box.i_max > nx-2)
+    {
+        if (box.i_min < 0)
+        {
+            box.j_min -= (nx-2 - box.i_min) / (nx-1);
+        }
+        if (box.i_max > nx-2)
+        {
+            box.j_max += box.i_max / (nx-1);
+        }
+        box.i_min = 0;
+        box.i_max = nx-1;
+    }
+    if (box.j_min < 0 || box.j_max > ny-2)
+    {
+        if (box.j_min < 0)
+        {
+            box.k_min -= (ny-2 - box.j_min) / (ny-1);
+        }
+        if (box.j_max > ny-2)
+        {
+            box.k_max += box.j_max / (ny-1);
+        }
+        box.j_min = 0;
+        box.j_max = ny-1;
+    }
+    box.k_min = std::max(box.k_min, 0);
+    box.k_max = std::min(box.k_max, nz-1);
+}
@@ -0,0 +1,117 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * Applies a parameterization (upwind cavity, wake, street canyon,
+ * sidewall or rooftop) to all the buildings, with the same result as
+ * applying it to one building after the other in the order of
+ * building_id (increasing effective heights).
+ *
+ * With several OpenMP threads, each building gives the box of the
+ * cells that its parameterization may read or write
+ * (Building::prepareParameterization) and the buildings are put in
+ * batches: a building goes in the batch after the last one with a
+ * building whose box overlaps its own. The buildings of a batch are
+ * independent and applied in parallel, the overlapping buildings are
+ * applied in the order of building_id.
+ *
+ * The box of a building depends on the velocity at the centroid of its
+ * roof, so it is found when this velocity is final: the buildings
+ * waiting to be applied are applied first when one of them may change
+ * it.
+ *
+ * With a parameterization cache, the buildings always go through the
+ * batches, whose boxes give the cells kept in the zones of the cache.
+ */
+
+#include <vector>
+
+#include "Building.h"
+
+class BuildingScheduler
+{
+public:
+
+    /*
+     * Applies the parameterization p to all the buildings of WGD.
+     */
+    static void apply(Building::Parameterization p, const WINDSInputData *WID, WINDSGeneralData *WGD);
+
+private:
+
+    BuildingScheduler(Building::Parameterization p, const WINDSInputData *WID, WINDSGeneralData *WGD);
+
+    /*
+     * Puts the buildings in batches and applies them.
+     */
+    void run();
+
+    /*
+     * Adds a building (not a canopy) to the waiting buildings.
+     */
+    void add(int id, Building::CellBox box);
+
+    /*
+     * Returns true if the box of a waiting building holds (i, j, k).
+     */
+    bool isWaiting(int i, int j, int k) const;
+
+    /*
+     * Applies the waiting buildings, batch after batch.
+     */
+    void flush();
+
+    /*
+     * Extends a box with indices out of the rows (layers) of the
+     * domain to the whole rows (layers) that they refer to.
+     */
+    void wrap(Building::CellBox &box) const;
+
+    static const int tileSize = 16;     // Size of the tiles of columns
+
+    Building::Parameterization m_p;
+    const WINDSInputData *m_WID;
+    WINDSGeneralData *m_WGD;
+    int nx, ny, nz;
+
+    std::vector<int> m_ids;                     // Waiting buildings, in the order of building_id
+    std::vector<Building::CellBox> m_boxes;     // Their boxes
+    std::vector<int> m_batches;                 // Their batches
+    int m_numBatches = 0;
+
+    int m_tilesX, m_tilesY;
+    std::vector<std::vector<int>> m_tiles;      // Waiting buildings whose box covers each tile
+    std::vector<int> m_seen;                    // Last building checked against each waiting building
+};
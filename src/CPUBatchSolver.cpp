@@ -0,0 +1,302 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#include "CPUBatchSolver.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::cout;
+
+void CPUBatchSolver::addScenario(const WINDSGeneralData* WGD)
+{
+    Scenario scenario;
+    scenario.u = WGD->u0;
+    scenario.v = WGD->v0;
+    scenario.w = WGD->w0;
+    scenario.icellflag = WGD->icellflag;
+    scenarios.push_back(scenario);
+}
+
+
+void CPUBatchSolver::loadScenario(WINDSGeneralData* WGD, int s) const
+{
+    // As in CPUSolver, the faces above the top cells are not part of
+    // the solution and u,v,w keep their values there
+    size_t numSolved = (size_t)(WGD->nz-1)*WGD->nx*WGD->ny;
+    std::copy(scenarios[s].u.begin(), scenarios[s].u.begin() + numSolved, WGD->u.begin());
+    std::copy(scenarios[s].v.begin(), scenarios[s].v.begin() + numSolved, WGD->v.begin());
+    std::copy(scenarios[s].w.begin(), scenarios[s].w.begin() + numSolved, WGD->w.begin());
+    loadScenarioFlags(WGD, s);
+}
+
+
+void CPUBatchSolver::loadScenarioFlags(WINDSGeneralData* WGD, int s) const
+{
+    WGD->icellflag = scenarios[s].icellflag;
+}
+
+
+void CPUBatchSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind)
+{
+    clearScenarios();
+    addScenario(WGD);
+    solveBatch(WID, WGD, solveWind);
+    if (solveWind)
+    {
+        loadScenario(WGD, 0);
+    }
+    clearScenarios();
+}
+
+
+void CPUBatchSolver::solveBatch(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind)
+{
+    auto startOfSolveMethod = std::chrono::high_resolution_clock::now(); // Start recording execution time
+
+    const int K = scenarios.size();     /// Number of scenarios in the batch
+    if (K == 0)
+    {
+        return;
+    }
+
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const long stride_j = nx-1;             /// Offset between j-neighbors (cells)
+    const long stride_k = (nx-1)*(ny-1);    /// Offset between k-neighbors (cells)
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+    /////////////////////////////////////////////////////////////////
+    ////////      Divergence of the initial velocity fields  ////////
+    /////////////////////////////////////////////////////////////////
+
+    // lambda and R hold the K values of a cell next to each other
+    R.assign( (size_t)WGD->numcell_cent*K, 0.0 );
+    lambda.assign( (size_t)WGD->numcell_cent*K, 0.0 );
+
+    for (int s = 0; s < K; s++)
+    {
+        const Scenario &sc = scenarios[s];
+        for (int k = 1; k < nz-2; k++)
+        {
+            for (int j = 0; j < ny-1; j++)
+            {
+                for (int i = 0; i < nx-1; i++)
+                {
+                    int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                    int icell_face = i + j*nx + k*nx*ny;
+
+                    /// Calculate divergence of initial velocity field
+                    R[(size_t)icell_cent*K + s] = (-2*pow(alpha1, 2.0))*((( sc.u[icell_face+1]     - sc.u[icell_face]) / WGD->dx ) +
+                                                                         (( sc.v[icell_face + nx]  - sc.v[icell_face]) / WGD->dy ) +
+                                                                         (( sc.w[icell_face + nx*ny] - sc.w[icell_face]) / WGD->dz_array[k] ));
+                }
+            }
+        }
+    }
+
+    if (!solveWind)
+    {
+        return;
+    }
+
+    auto startSolveSection = std::chrono::high_resolution_clock::now();
+
+    /////////////////////////////////////////////////
+    //          SOR solver (batched)           //////
+    /////////////////////////////////////////////////
+    loadCoefficients(WGD);
+
+    int iter = 0;
+    float batch_error = 1.0;          /// Largest change over all the scenarios
+    max_error.assign(K, 1.0);
+    sum_error2.assign(K, 0.0);
+    std::vector<int> converged(K, 0); /// Iteration at which each scenario converged
+
+    std::cout << "Solving " << K << " scenarios...\n";
+    while (iter < itermax && batch_error > tol) {
+
+        // The last iteration is always checked, so that the reported
+        // error is the one of the final solution
+        bool checkConvergence = ((iter+1) % convergenceInterval == 0 || iter+1 == itermax);
+        if (checkConvergence)
+        {
+            max_error.assign(K, 0.0);
+            sum_error2.assign(K, 0.0);
+        }
+
+        //
+        // main SOR formulation loop, the coefficients of a cell are
+        // used by all the scenarios
+        //
+        for (int k = 1; k < nz-2; k++){
+            for (int j = 1; j < ny-2; j++){
+                for (int sp = spans->rowBegin(j,k); sp < spans->rowEnd(j,k); sp++){
+                for (int i = MAX_S(1, spans->spanStart[sp]); i < MIN_S(nx-2, spans->spanEnd[sp]); i++){
+
+                    long icell_cent = i + j*stride_j + k*stride_k;   /// Lineralized index for cell centered values
+
+                    const float ce = coeff.e[icell_cent], cf = coeff.f[icell_cent];
+                    const float cg = coeff.g[icell_cent], ch = coeff.h[icell_cent];
+                    const float cm = coeff.m[icell_cent], cn = coeff.n[icell_cent];
+                    const float factor = omega / ( ce + cf + cg + ch + cm + cn );
+
+                    float *lam = lambda.data() + icell_cent*K;
+                    const float *rhs = R.data() + icell_cent*K;
+
+                    for (int s = 0; s < K; s++)
+                    {
+                        float lambda_new = factor *
+                            ( ce * lam[s + K]          + cf * lam[s - K] +
+                              cg * lam[s + stride_j*K] + ch * lam[s - stride_j*K] +
+                              cm * lam[s + stride_k*K] + cn * lam[s - stride_k*K] - rhs[s] ) +
+                            (1.0 - omega) * lam[s];    /// SOR formulation
+
+                        /// Error calculation
+                        if (checkConvergence)
+                        {
+                            float error = fabs(lambda_new - lam[s]);
+                            sum_error2[s] += error*error;
+                            if (error > max_error[s])
+                            {
+                                max_error[s] = error;
+                            }
+                        }
+
+                        lam[s] = lambda_new;
+                    }
+                }
+                }
+            }
+        }
+
+        /// Mirror boundary condition (lambda (@k=0) = lambda (@k=1))
+        std::copy(lambda.begin() + stride_k*K, lambda.begin() + 2*stride_k*K, lambda.begin());
+
+        if (checkConvergence)
+        {
+            batch_error = 0.0;
+            for (int s = 0; s < K; s++)
+            {
+                if (converged[s] == 0 && max_error[s] <= tol)
+                {
+                    converged[s] = iter+1;
+                }
+                batch_error = MAX_S(batch_error, max_error[s]);
+            }
+        }
+
+        iter += 1;
+    }
+    std::cout << "Solved!\n";
+    iterations = iter;
+
+    std::cout << "Number of iterations:" << iter << "\n";   // Print the number of iterations
+    for (int s = 0; s < K; s++)
+    {
+        std::cout << "Scenario " << s << ": error " << max_error[s] << ", L2 change " << sqrt(sum_error2[s]);
+        if (converged[s] > 0)
+        {
+            std::cout << ", converged after " << converged[s] << " iterations";
+        }
+        std::cout << "\n";
+    }
+    std::cout << "tol:" << tol << "\n";
+
+
+    // /////////////////////////////////////////////
+    /// Update velocity fields using Euler equations
+    // /////////////////////////////////////////////
+    for (int s = 0; s < K; s++)
+    {
+        Scenario &sc = scenarios[s];
+
+        for (int k = 1; k < nz-2; k++)
+        {
+            for (int j = 1; j < ny-1; j++)
+            {
+                for (int sp = spans->rowBegin(j,k); sp < spans->rowEnd(j,k); sp++)
+                {
+                    for (int i = MAX_S(1, spans->spanStart[sp]); i < MIN_S(nx-1, spans->spanEnd[sp]); i++)
+                    {
+                        long icell_cent = i + j*stride_j + k*stride_k;   /// Lineralized index for cell centered values
+                        int icell_face = i + j*nx + k*nx*ny;             /// Lineralized index for cell faced values
+                        const float *lam = lambda.data() + icell_cent*K + s;
+
+                        sc.u[icell_face] = sc.u[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            coeff.f[icell_cent]*WGD->dx*(lam[0]-lam[-K]);
+
+                        sc.v[icell_face] = sc.v[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            coeff.h[icell_cent]*WGD->dy*(lam[0]-lam[-stride_j*K]);
+
+                        sc.w[icell_face] = sc.w[icell_face] + (1/(2*pow(alpha2, 2.0))) *
+                            coeff.n[icell_cent]*WGD->dz_array[k]*(lam[0]-lam[-stride_k*K]);
+                    }
+                }
+            }
+        }
+
+        for (int k = 1; k < nz-1; k++)
+        {
+            for (int j = 0; j < ny-1; j++)
+            {
+                for (int i = 0; i < nx-1; i++)
+                {
+                    int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);   /// Lineralized index for cell centered values
+                    int icell_face = i + j*nx + k*nx*ny;               /// Lineralized index for cell faced values
+
+                    // If we are inside a building, set velocities to 0.0
+                    if (WGD->icellflag[icell_cent] == 0 || WGD->icellflag[icell_cent] == 2)
+                    {
+                        /// Setting velocity field inside the building to zero
+                        sc.u[icell_face] = 0;
+                        sc.u[icell_face+1] = 0;
+                        sc.v[icell_face] = 0;
+                        sc.v[icell_face+nx] = 0;
+                        sc.w[icell_face] = 0;
+                        sc.w[icell_face+nx*ny] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    auto finish = std::chrono::high_resolution_clock::now();  // Finish recording execution time
+    std::chrono::duration<float> elapsedTotal = finish - startOfSolveMethod;
+    std::chrono::duration<float> elapsedSolve = finish - startSolveSection;
+    std::cout << "Elapsed total time: " << elapsedTotal.count() << " s\n";   // Print out elapsed execution time
+    std::cout << "Elapsed solve time: " << elapsedSolve.count() << " s\n";   // Print out elapsed execution time
+}
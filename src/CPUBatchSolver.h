@@ -0,0 +1,121 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#pragma once
+
+/*
+ * This is child class of the solver that runs the SOR algorithm on a
+ * batch of inflow scenarios sharing the same domain.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "WINDSInputData.h"
+#include "Solver.h"
+
+
+/**
+ * Batched SOR solver
+ *
+ * The scenarios (initial fields u0,v0,w0 of different inflows) share
+ * icellflag and the coefficients e,f,g,h,m,n, so their K lambda
+ * vectors are swept in lockstep: lambda and R are stored interleaved
+ * (cell-major, K values per cell) and the coefficients of each cell
+ * are loaded once for the whole batch.  The sweep stops when every
+ * scenario has converged.
+ *
+ * Scenarios are added with addScenario(), solved with solveBatch()
+ * and copied back to the velocity of WINDSGeneralData one at a time
+ * with loadScenario().  solve() runs a batch of one.
+ */
+class CPUBatchSolver : public Solver
+{
+public:
+    CPUBatchSolver(const WINDSInputData* WID, WINDSGeneralData* WGD)
+        : Solver(WID, WGD)
+    {
+    }
+
+    /*
+     * Adds the current initial velocity field of WGD to the batch.
+     */
+    void addScenario(const WINDSGeneralData* WGD);
+
+    /*
+     * Solves all the scenarios of the batch together.
+     */
+    void solveBatch(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind);
+
+    /*
+     * Copies the velocity field of scenario s into u,v,w of WGD, and
+     * its cell flags into icellflag.
+     */
+    void loadScenario(WINDSGeneralData* WGD, int s) const;
+
+    /*
+     * Copies the cell flags of scenario s (set by the parameterizations
+     * of its initial field) into icellflag of WGD.
+     */
+    void loadScenarioFlags(WINDSGeneralData* WGD, int s) const;
+
+    /*
+     * Removes all the scenarios of the batch.
+     */
+    void clearScenarios() { scenarios.clear(); }
+
+    int numScenarios() const { return scenarios.size(); }
+
+protected:
+
+    /// Velocity of a scenario: the initial field until the batch is
+    /// solved, the solution afterwards, and its cell flags
+    struct Scenario
+    {
+        std::vector<float> u, v, w;
+        std::vector<int> icellflag;
+    };
+    std::vector<Scenario> scenarios;
+
+    std::vector<float> max_error;   /**< Largest change of lambda per scenario */
+    std::vector<double> sum_error2; /**< Sum of the squared changes per scenario */
+
+    virtual void solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind);
+};
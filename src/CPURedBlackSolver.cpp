@@ -0,0 +1,383 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "CPURedBlackSolver.h"
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::cout;
+
+CPURedBlackSolver::CPURedBlackSolver(const WINDSInputData* WID, WINDSGeneralData* WGD)
+    : Solver(WID, WGD), halfWidth(0), colorSize(0), colorGeometry(nullptr)
+{
+#ifdef _OPENMP
+    numThreads = omp_get_max_threads();
+#else
+    numThreads = 1;
+#endif
+
+    kernelType = bestSORKernel();
+    rowKernel = sorKernel(kernelType);
+}
+
+
+void CPURedBlackSolver::splitCoefficients(WINDSGeneralData* WGD)
+{
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+
+    // One spare cell at the end of each row so that the i+1 neighbor
+    // of the last cell is always inside the row
+    halfWidth = nx/2 + 1;
+    colorSize = halfWidth*(ny-1)*(nz-1);
+
+    for (int c = 0; c < 2; c++)
+    {
+        lambdaColor[c].assign( colorSize, 0.0 );
+        ce[c].assign( colorSize, 0.0 );
+        cf[c].assign( colorSize, 0.0 );
+        cg[c].assign( colorSize, 0.0 );
+        ch[c].assign( colorSize, 0.0 );
+        cm[c].assign( colorSize, 0.0 );
+        cn[c].assign( colorSize, 0.0 );
+        invDiag[c].assign( colorSize, 0.0 );
+        rr[c].assign( colorSize, 0.0 );
+    }
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 0; k < nz-1; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            for (int i = 0; i < nx-1; i++)
+            {
+                long icell_cent = i + j*(nx-1) + (long)k*(nx-1)*(ny-1);
+                int c = (i + j + k) & 1;
+                long id = colorIndex(i, j, k, ny);
+
+                float coef[6];
+                WGD->getCoefficients(icell_cent, k, coef);
+
+                float diag = coef[0] + coef[1] + coef[2] + coef[3] + coef[4] + coef[5];
+                // A cell cut off from the fluid keeps lambda = 0
+                float inv = (diag > 0.0) ? omega/diag : 0.0;
+
+                ce[c][id] = coef[0]*inv;
+                cf[c][id] = coef[1]*inv;
+                cg[c][id] = coef[2]*inv;
+                ch[c][id] = coef[3]*inv;
+                cm[c][id] = coef[4]*inv;
+                cn[c][id] = coef[5]*inv;
+                invDiag[c][id] = inv;
+            }
+        }
+    }
+
+    colorGeometry = WGD;
+}
+
+
+void CPURedBlackSolver::splitLambda(WINDSGeneralData* WGD)
+{
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 0; k < nz-1; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            for (int i = 0; i < nx-1; i++)
+            {
+                long icell_cent = i + j*(nx-1) + (long)k*(nx-1)*(ny-1);
+                int c = (i + j + k) & 1;
+                long id = colorIndex(i, j, k, ny);
+                lambdaColor[c][id] = lambda[icell_cent];
+                rr[c][id] = R[icell_cent]*invDiag[c][id];
+            }
+        }
+    }
+}
+
+
+void CPURedBlackSolver::mergeLambda(WINDSGeneralData* WGD)
+{
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 0; k < nz-1; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            for (int i = 0; i < nx-1; i++)
+            {
+                long icell_cent = i + j*(nx-1) + (long)k*(nx-1)*(ny-1);
+                lambda[icell_cent] = lambdaColor[(i + j + k) & 1][colorIndex(i, j, k, ny)];
+            }
+        }
+    }
+}
+
+
+float CPURedBlackSolver::colorSweep(WINDSGeneralData* WGD, int color)
+{
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const long stride_j = halfWidth;            /// Offset between j-neighbors
+    const long stride_k = halfWidth*(ny-1);     /// Offset between k-neighbors
+
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+    float *self = lambdaColor[color].data();
+    const float *other = lambdaColor[1-color].data();
+
+    float max_error = 0.0;
+
+#pragma omp parallel for collapse(2) schedule(static) reduction(max:max_error)
+    for (int k = 1; k < nz-2; k++){
+        for (int j = 1; j < ny-2; j++){
+            // Cells of this color on the row are at i = 2*h + p.  Their
+            // j and k neighbors sit at the same h in the other color,
+            // the i-1 and i+1 neighbors at h-1 and h (p = 0) or at h
+            // and h+1 (p = 1).
+            int p = (color + j + k) & 1;
+
+            // Building and terrain cells between the spans are skipped,
+            // spans separated by narrow gaps are swept as one
+            int s = spans->rowBegin(j,k);
+            const int s_end = spans->rowEnd(j,k);
+            while (s < s_end)
+            {
+                int span_start = spans->spanStart[s];
+                int span_end = spans->spanEnd[s];
+                for (s++; s < s_end && spans->spanStart[s] - span_end < minSpanGap; s++)
+                {
+                    span_end = spans->spanEnd[s];
+                }
+
+                int i_first = MAX_S(1, span_start);         /// first interior cell (i >= 1)
+                int i_last = MIN_S(nx-3, span_end-1);       /// last interior cell (i <= nx-3)
+                if (i_last < i_first)
+                {
+                    continue;
+                }
+                int h_start = (i_first - p + 1)/2;
+                int h_end = (i_last - p)/2;
+                if (h_end < h_start)
+                {
+                    continue;
+                }
+                long id = h_start + j*stride_j + k*stride_k;
+
+                SORRow row;
+                row.lambda = self + id;
+                row.east = other + id + p;
+                row.west = other + id + p - 1;
+                row.north = other + id + stride_j;
+                row.south = other + id - stride_j;
+                row.up = other + id + stride_k;
+                row.down = other + id - stride_k;
+                row.ce = ce[color].data() + id;
+                row.cf = cf[color].data() + id;
+                row.cg = cg[color].data() + id;
+                row.ch = ch[color].data() + id;
+                row.cm = cm[color].data() + id;
+                row.cn = cn[color].data() + id;
+                row.rr = rr[color].data() + id;
+                row.count = h_end - h_start + 1;
+
+                float error = rowKernel(row, omega);
+                if (error > max_error)
+                {
+                    max_error = error;
+                }
+            }
+        }
+    }
+
+    return max_error;
+}
+
+
+void CPURedBlackSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind)
+{
+    auto startOfSolveMethod = std::chrono::high_resolution_clock::now(); // Start recording execution time
+
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+    /////////////////////////////////////////////////////////////////
+    ////////      Divergence of the initial velocity field   ////////
+    /////////////////////////////////////////////////////////////////
+
+    R.resize( WGD->numcell_cent, 0.0 );
+    initialGuess(WGD);
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k < nz-2; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            for (int i = 0; i < nx-1; i++)
+            {
+                int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                int icell_face = i + j*nx + k*nx*ny;
+
+                /// Calculate divergence of initial velocity field
+                R[icell_cent] = (-2*pow(alpha1, 2.0))*((( WGD->u0[icell_face+1]     - WGD->u0[icell_face]) / WGD->dx ) +
+                                                       (( WGD->v0[icell_face + nx]    - WGD->v0[icell_face]) / WGD->dy ) +
+                                                       (( WGD->w0[icell_face + nx*ny] - WGD->w0[icell_face]) / WGD->dz_array[k] ));
+            }
+        }
+    }
+
+
+    if (solveWind)
+    {
+        auto startSolveSection = std::chrono::high_resolution_clock::now();
+
+        /////////////////////////////////////////////////
+        //           Red-black SOR solver          //////
+        /////////////////////////////////////////////////
+        int iter = 0;
+        float max_error = 1.0;
+
+        // The coefficients do not change between time steps
+        if (colorGeometry != WGD || colorSize != halfWidth*(ny-1)*(nz-1))
+        {
+            splitCoefficients(WGD);
+        }
+        splitLambda(WGD);
+
+        std::cout << "Solving with " << numThreads << " thread(s), "
+                  << sorKernelName(kernelType) << " kernel...\n";
+        while (iter < itermax && max_error > tol) {
+
+            // The change of lambda is measured inside the sweeps, so
+            // no copy of the previous iteration is needed
+            float error_red = colorSweep(WGD, 0);
+            float error_black = colorSweep(WGD, 1);
+            max_error = MAX_S(error_red, error_black);
+
+            /// Mirror boundary condition (lambda (@k=0) = lambda (@k=1))
+            /// (the change at k=0 is the same as the change at k=1).
+            /// The cell above has the other color and the same index in its row.
+            for (int c = 0; c < 2; c++){
+                std::copy( lambdaColor[1-c].begin() + halfWidth*(ny-1),
+                           lambdaColor[1-c].begin() + 2*halfWidth*(ny-1),
+                           lambdaColor[c].begin() );
+            }
+
+            iter += 1;
+        }
+        mergeLambda(WGD);
+        std::cout << "Solved!\n";
+        iterations = iter;
+
+        std::cout << "Number of iterations:" << iter << "\n";   // Print the number of iterations
+        std::cout << "Error:" << max_error << "\n";
+        std::cout << "tol:" << tol << "\n";
+
+
+        ////////////////////////////////////////////////////////////////////////
+        /////   Update the velocity field using Euler-Lagrange equations   /////
+        ////////////////////////////////////////////////////////////////////////
+
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < nz-1; k++)
+        {
+            for (int j = 0; j < ny; j++)
+            {
+                for (int i = 0; i < nx; i++)
+                {
+                    int icell_face = i + j*nx + k*nx*ny;   /// Lineralized index for cell faced values
+                    WGD->u[icell_face] = WGD->u0[icell_face];
+                    WGD->v[icell_face] = WGD->v0[icell_face];
+                    WGD->w[icell_face] = WGD->w0[icell_face];
+                }
+            }
+        }
+
+        // /////////////////////////////////////////////
+        /// Update velocity field using Euler equations
+        // /////////////////////////////////////////////
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int k = 1; k < nz-2; k++)
+        {
+            for (int j = 1; j < ny-1; j++)
+            {
+                for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++)
+                {
+                    for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(nx-1, spans->spanEnd[s]); i++)
+                    {
+                        int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);   /// Lineralized index for cell centered values
+                        int icell_face = i + j*nx + k*nx*ny;               /// Lineralized index for cell faced values
+
+                        float c[6];
+                        WGD->getCoefficients(icell_cent, k, c);
+
+                        WGD->u[icell_face] = WGD->u0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[1]*WGD->dx*(lambda[icell_cent]-lambda[icell_cent-1]);
+
+                        WGD->v[icell_face] = WGD->v0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[3]*WGD->dy*(lambda[icell_cent]-lambda[icell_cent - (nx-1)]);
+
+                        WGD->w[icell_face] = WGD->w0[icell_face]+(1/(2*pow(alpha2, 2.0))) *
+                            c[5]*WGD->dz_array[k]*(lambda[icell_cent]-lambda[icell_cent - (nx-1)*(ny-1)]);
+                    }
+                }
+            }
+        }
+
+        zeroSolidVelocities(WGD);
+
+        auto finish = std::chrono::high_resolution_clock::now();  // Finish recording execution time
+        std::chrono::duration<float> elapsedTotal = finish - startOfSolveMethod;
+        std::chrono::duration<float> elapsedSolve = finish - startSolveSection;
+        std::cout << "Elapsed total time: " << elapsedTotal.count() << " s\n";   // Print out elapsed execution time
+        std::cout << "Elapsed solve time: " << elapsedSolve.count() << " s\n";   // Print out elapsed execution time
+    }
+}
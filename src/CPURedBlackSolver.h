@@ -0,0 +1,125 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * This is child class of the solver that runs the convergence
+ * algorithm with red-black (checkerboard) ordering on a multi-core
+ * CPU using OpenMP.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "WINDSInputData.h"
+#include "Solver.h"
+#include "SORKernels.h"
+
+
+/**
+ * Red-black SOR solver
+ *
+ * Cells are split into two colors by the parity of (i+j+k).  With the
+ * 7-point stencil every neighbor of a red cell is black and vice versa,
+ * so all cells of one color can be updated at the same time.  Each
+ * iteration is a red half-sweep followed by a black half-sweep, both
+ * shared between the available OpenMP threads.
+ *
+ * Each color is stored in its own array, row by row, so that the cells
+ * updated by a half-sweep and all of their neighbors are contiguous.
+ * The coefficients are divided by the diagonal once per geometry.  The
+ * rows are then updated by the widest SIMD kernel the CPU supports
+ * (see SORKernels.h).
+ */
+class CPURedBlackSolver : public Solver
+{
+public:
+    CPURedBlackSolver(const WINDSInputData* WID, WINDSGeneralData* WGD);
+
+protected:
+
+    int numThreads;          /**< Number of threads used by the solver */
+
+    /// Building and terrain gaps narrower than this (in cells) are swept
+    /// through: splitting a row there costs more than the skipped cells
+    const int minSpanGap = 16;
+
+    SORKernelType kernelType;     /**< SIMD instruction set of the row kernel */
+    SORRowKernel rowKernel;       /**< Row update kernel */
+
+    long halfWidth;          /**< Length of one row of a color array */
+    long colorSize;          /**< Length of a color array */
+
+    std::vector<float> lambdaColor[2];                 /**< Lagrange multipliers of each color */
+    std::vector<float> ce[2], cf[2], cg[2], ch[2], cm[2], cn[2];   /**< Coefficients times omega/diagonal */
+    std::vector<float> invDiag[2];                     /**< omega/diagonal (0 for cells cut off from the fluid) */
+    std::vector<float> rr[2];                          /**< Divergence times omega/diagonal */
+    const WINDSGeneralData* colorGeometry;             /**< Data the coefficients were split from */
+
+    /*
+     * Index of cell (i,j,k) in the array of its color.
+     */
+    long colorIndex(int i, int j, int k, int ny) const
+    {
+        return (i >> 1) + halfWidth*(j + (long)(ny-1)*k);
+    }
+
+    /*
+     * Splits the coefficients by color and scales them by omega over
+     * the diagonal.  Only needed once per geometry.
+     */
+    void splitCoefficients(WINDSGeneralData* WGD);
+
+    /*
+     * Copies lambda to the color arrays and back.
+     */
+    void splitLambda(WINDSGeneralData* WGD);
+    void mergeLambda(WINDSGeneralData* WGD);
+
+    /*
+     * Performs one SOR half-sweep over the cells of a single color and
+     * returns the maximum change of lambda in the updated cells.
+     *
+     * @param WGD -the general WINDS data
+     * @param color -0 for red cells, 1 for black cells
+     */
+    float colorSweep(WINDSGeneralData* WGD, int color);
+
+    virtual void solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind);
+};
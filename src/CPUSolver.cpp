@@ -38,6 +38,48 @@ using std::endl;
 using std::vector;
 using std::cout;
 
+template <typename Coefficients>
+void CPUSolver::sweep(WINDSGeneralData* WGD, const Coefficients &coefficients, bool checkConvergence,
+                      float &max_error, double &sum_error2)
+{
+    float c[6];                       /// Coefficients of the current cell
+    float error;
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+    for (int k = 1; k < WGD->nz-2; k++){
+        for (int j = 1; j < WGD->ny-2; j++){
+            for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++){
+            for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(WGD->nx-2, spans->spanEnd[s]); i++){
+
+                long icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);   /// Lineralized index for cell centered values
+
+                coefficients(icell_cent, k, c);    /// Coefficients e,f,g,h,m,n
+
+                float lambda_new = (omega / ( c[0] + c[1] + c[2] + c[3] + c[4] + c[5] )) *
+                    ( c[0] * lambda[icell_cent+1]        + c[1] * lambda[icell_cent-1] +
+                      c[2] * lambda[icell_cent + (WGD->nx-1)] + c[3] * lambda[icell_cent-(WGD->nx-1)] +
+                      c[4] * lambda[icell_cent+(WGD->nx-1)*(WGD->ny-1)] +
+                      c[5] * lambda[icell_cent-(WGD->nx-1)*(WGD->ny-1)] - R[icell_cent] ) +
+                    (1.0 - omega) * lambda[icell_cent];    /// SOR formulation
+
+                /// Error calculation
+                if (checkConvergence)
+                {
+                    error = fabs(lambda_new - lambda[icell_cent]);
+                    sum_error2 += error*error;
+                    if (error > max_error)
+                    {
+                        max_error = error;
+                    }
+                }
+
+                lambda[icell_cent] = lambda_new;
+            }
+            }
+        }
+    }
+}
+
 void CPUSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind)
 {
     auto startOfSolveMethod = std::chrono::high_resolution_clock::now(); // Start recording execution time
@@ -51,8 +93,7 @@ void CPUSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool sol
 
     R.resize( WGD->numcell_cent, 0.0 );
 
-    lambda.resize( WGD->numcell_cent, 0.0 );
-    lambda_old.resize( WGD->numcell_cent, 0.0 );
+    initialGuess(WGD, true);
 
     for (int k = 1; k < WGD->nz-2; k++)
     {
@@ -84,35 +125,48 @@ void CPUSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool sol
         //                 SOR solver              //////
         /////////////////////////////////////////////////
         int iter = 0;
-        float error;
         float max_error = 1.0;
+        double sum_error2 = 0.0;          /// Sum of the squared changes (L2-norm)
+        float c[6];                       /// Coefficients of the current cell
+        const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
 
         std::cout << "Solving...\n";
         while (iter < itermax && max_error > tol) {
 
-            // Save previous iteration values for error calculation
-            //    uses stl vector's assignment copy function, assign
-            lambda_old.assign( lambda.begin(), lambda.end() );
+            // The change of lambda is measured while it is updated,
+            // so no copy of the previous iteration is needed.  Cells
+            // outside of the sweep do not change, and the mirrored
+            // cells at k=0 change exactly as the cells at k=1.
+            // The last iteration is always checked, so that the reported
+            // error is the one of the final solution
+            bool checkConvergence = ((iter+1) % convergenceInterval == 0 || iter+1 == itermax);
+            if (checkConvergence)
+            {
+                max_error = 0.0;                   /// Reset error value before error calculation
+                sum_error2 = 0.0;
+            }
 
             //
-            // main SOR formulation loop
+            // main SOR formulation loop, with the check for compressed
+            // coefficients outside of the loop
             //
-            for (int k = 1; k < WGD->nz-2; k++){
-            	for (int j = 1; j < WGD->ny-2; j++){
-            	    for (int i = 1; i < WGD->nx-2; i++){
-
-            	        icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);   /// Lineralized index for cell centered values
-
-                        lambda[icell_cent] = (omega / ( WGD->e[icell_cent] + WGD->f[icell_cent] + WGD->g[icell_cent] +
-                                                        WGD->h[icell_cent] + WGD->m[icell_cent] + WGD->n[icell_cent])) *
-                            ( WGD->e[icell_cent] * lambda[icell_cent+1]        + WGD->f[icell_cent] * lambda[icell_cent-1] +
-                              WGD->g[icell_cent] * lambda[icell_cent + (WGD->nx-1)] + WGD->h[icell_cent] * lambda[icell_cent-(WGD->nx-1)] +
-                              WGD->m[icell_cent] * lambda[icell_cent+(WGD->nx-1)*(WGD->ny-1)] +
-                              WGD->n[icell_cent] * lambda[icell_cent-(WGD->nx-1)*(WGD->ny-1)] - R[icell_cent] ) +
-                            (1.0 - omega) * lambda[icell_cent];    /// SOR formulation
-
-                    }
-                }
+            if (WGD->compressedCoeff == nullptr)
+            {
+                const float *e = WGD->e.data(), *f = WGD->f.data(), *g = WGD->g.data();
+                const float *h = WGD->h.data(), *m = WGD->m.data(), *n = WGD->n.data();
+                sweep(WGD, [=](long id, int k, float c[6])
+                      {
+                          c[0] = e[id]; c[1] = f[id]; c[2] = g[id];
+                          c[3] = h[id]; c[4] = m[id]; c[5] = n[id];
+                      }, checkConvergence, max_error, sum_error2);
+            }
+            else
+            {
+                const CompressedCoefficients *compressed = WGD->compressedCoeff;
+                sweep(WGD, [=](long id, int k, float c[6])
+                      {
+                          compressed->cell(id, k, c);
+                      }, checkConvergence, max_error, sum_error2);
             }
 
             /// Mirror boundary condition (lambda (@k=0) = lambda (@k=1))
@@ -123,27 +177,14 @@ void CPUSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool sol
                 }
             }
 
-            /// Error calculation
-            max_error = 0.0;                   /// Reset error value before error calculation
-            for (int k = 0; k < WGD->nz-1; k++){
-                for (int j = 0; j < WGD->ny-1; j++){
-                    for (int i = 0; i < WGD->nx-1; i++){
-                        int icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);   /// Lineralized index for cell centered values
-                        error = fabs(lambda[icell_cent] - lambda_old[icell_cent]);
-                        if (error > max_error)
-                        {
-                          max_error = error;
-                        }
-                    }
-                }
-            }
-
             iter += 1;
         }
         std::cout << "Solved!\n";
+        iterations = iter;
 
         std::cout << "Number of iterations:" << iter << "\n";   // Print the number of iterations
         std::cout << "Error:" << max_error << "\n";
+        std::cout << "L2 change:" << sqrt(sum_error2) << "\n";
         std::cout << "tol:" << tol << "\n";
 
 
@@ -173,20 +214,25 @@ void CPUSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool sol
         {
             for (int j = 1; j < WGD->ny-1; j++)
             {
-                for (int i = 1; i < WGD->nx-1; i++)
+                for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++)
                 {
-                    icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);   /// Lineralized index for cell centered values
-                    icell_face = i + j*WGD->nx + k*WGD->nx*WGD->ny;               /// Lineralized index for cell faced values
+                    for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(WGD->nx-1, spans->spanEnd[s]); i++)
+                    {
+                        icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);   /// Lineralized index for cell centered values
+                        icell_face = i + j*WGD->nx + k*WGD->nx*WGD->ny;               /// Lineralized index for cell faced values
 
-                    WGD->u[icell_face] = WGD->u0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
-                        WGD->f[icell_cent]*WGD->dx*(lambda[icell_cent]-lambda[icell_cent-1]);
+                        WGD->getCoefficients(icell_cent, k, c);
 
-                        // Calculate correct wind velocity
-                    WGD->v[icell_face] = WGD->v0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
-                        WGD->h[icell_cent]*WGD->dy*(lambda[icell_cent]-lambda[icell_cent - (WGD->nx-1)]);
+                        WGD->u[icell_face] = WGD->u0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[1]*WGD->dx*(lambda[icell_cent]-lambda[icell_cent-1]);
 
-                    WGD->w[icell_face] = WGD->w0[icell_face]+(1/(2*pow(alpha2, 2.0))) *
-                        WGD->n[icell_cent]*WGD->dz_array[k]*(lambda[icell_cent]-lambda[icell_cent - (WGD->nx-1)*(WGD->ny-1)]);
+                            // Calculate correct wind velocity
+                        WGD->v[icell_face] = WGD->v0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[3]*WGD->dy*(lambda[icell_cent]-lambda[icell_cent - (WGD->nx-1)]);
+
+                        WGD->w[icell_face] = WGD->w0[icell_face]+(1/(2*pow(alpha2, 2.0))) *
+                            c[5]*WGD->dz_array[k]*(lambda[icell_cent]-lambda[icell_cent - (WGD->nx-1)*(WGD->ny-1)]);
+                    }
                 }
             }
         }
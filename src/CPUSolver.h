@@ -60,4 +60,17 @@ public:
 protected:
 
     virtual void solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind);
+
+    /*
+     * This function runs one SOR iteration over the fluid cells. The
+     * coefficients of a cell are read with coefficients(icell_cent, k, c),
+     * so the full and the compressed storage each get their own loop.
+     *
+     * @param checkConvergence -measure the change of lambda
+     * @param max_error -largest change of lambda (if measured)
+     * @param sum_error2 -sum of the squared changes (if measured)
+     */
+    template <typename Coefficients>
+    void sweep(WINDSGeneralData* WGD, const Coefficients &coefficients, bool checkConvergence,
+               float &max_error, double &sum_error2);
 };
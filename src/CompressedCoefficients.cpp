@@ -0,0 +1,127 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#include "CompressedCoefficients.h"
+
+#include "WINDSGeneralData.h"
+
+
+CompressedCoefficients::CompressedCoefficients(const WINDSGeneralData *WGD)
+    : nx( WGD->nx ),
+      ny( WGD->ny ),
+      nz( WGD->nz ),
+      numcell_cent( WGD->numcell_cent )
+{
+    // Full value of each coefficient per level, as set for a cell with
+    // no solid neighbor by Wall::defineWalls and scaled by
+    // Wall::solverCoefficients (the first and last levels are not scaled)
+    table.assign( 6*(nz-1), 1.0f );
+    for (int k = 1; k < nz-2; k++)
+    {
+        float *full = &table[6*k];
+        full[0] = 1.0f/(WGD->dx*WGD->dx);
+        full[1] = 1.0f/(WGD->dx*WGD->dx);
+        full[2] = 1.0f/(WGD->dy*WGD->dy);
+        full[3] = 1.0f/(WGD->dy*WGD->dy);
+        full[4] = 1.0f/(WGD->dz_array[k]*0.5*(WGD->dz_array[k]+WGD->dz_array[k+1]));
+        full[5] = 1.0f/(WGD->dz_array[k]*0.5*(WGD->dz_array[k]+WGD->dz_array[k-1]));
+    }
+
+    const std::vector<float> *coef[6] = {&WGD->e, &WGD->f, &WGD->g, &WGD->h, &WGD->m, &WGD->n};
+
+    mask.assign( numcell_cent, 0 );
+    cutCell.clear();
+    cutCoef.clear();
+    for (long id = 0; id < numcell_cent; id++)
+    {
+        int k = id / ((nx-1)*(ny-1));
+        const float *full = &table[6*k];
+        unsigned char bits = 0;
+        for (int d = 0; d < 6; d++)
+        {
+            float value = (*coef[d])[id];
+            if (value == full[d])
+            {
+                bits |= (1 << d);
+            }
+            else if (value != 0.0f)
+            {
+                bits = CUT_CELL;
+                break;
+            }
+        }
+
+        mask[id] = bits;
+        if (bits & CUT_CELL)
+        {
+            cutCell.push_back(id);
+            for (int d = 0; d < 6; d++)
+            {
+                cutCoef.push_back((*coef[d])[id]);
+            }
+        }
+    }
+}
+
+
+void CompressedCoefficients::expand(std::vector<float> &e, std::vector<float> &f, std::vector<float> &g,
+                                    std::vector<float> &h, std::vector<float> &m, std::vector<float> &n) const
+{
+    e.resize( numcell_cent );
+    f.resize( numcell_cent );
+    g.resize( numcell_cent );
+    h.resize( numcell_cent );
+    m.resize( numcell_cent );
+    n.resize( numcell_cent );
+
+    for (long id = 0; id < numcell_cent; id++)
+    {
+        float c[6];
+        cell(id, id / ((nx-1)*(ny-1)), c);
+        e[id] = c[0];
+        f[id] = c[1];
+        g[id] = c[2];
+        h[id] = c[3];
+        m[id] = c[4];
+        n[id] = c[5];
+    }
+}
+
+
+size_t CompressedCoefficients::memoryUsage() const
+{
+    return mask.size()*sizeof(unsigned char) + table.size()*sizeof(float) +
+        cutCell.size()*sizeof(long) + cutCoef.size()*sizeof(float);
+}
@@ -0,0 +1,114 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#pragma once
+
+/*
+ * Compressed storage of the SOR solver coefficients (e,f,g,h,m,n).
+ *
+ * Outside of cut-cells each coefficient is either zero (solid
+ * neighbor) or the full value of its k-level, so a cell is stored as
+ * one bit per direction plus a per-level table.  Cut-cells keep their
+ * six values in a sorted exception list.
+ */
+
+#include <vector>
+#include <algorithm>
+
+class WINDSGeneralData;
+
+class CompressedCoefficients
+{
+public:
+
+    /// Bit set when the cell is a cut-cell stored in the exception list
+    static const unsigned char CUT_CELL = 0x40;
+
+    /*
+     * Builds the compressed form from the coefficient arrays of WGD
+     * (after Wall::solverCoefficients).  The compression is lossless.
+     */
+    CompressedCoefficients(const WINDSGeneralData *WGD);
+
+    /*
+     * Writes the coefficients (e,f,g,h,m,n) of cell id at level k
+     * into c.
+     */
+    inline void cell(long id, int k, float c[6]) const
+    {
+        const unsigned char bits = mask[id];
+        if (bits & CUT_CELL)
+        {
+            long ic = std::lower_bound(cutCell.begin(), cutCell.end(), id) - cutCell.begin();
+            for (int d = 0; d < 6; d++)
+            {
+                c[d] = cutCoef[6*ic + d];
+            }
+            return;
+        }
+
+        const float *full = &table[6*k];
+        for (int d = 0; d < 6; d++)
+        {
+            c[d] = ((bits >> d) & 1) ? full[d] : 0.0f;
+        }
+    }
+
+    /*
+     * Expands the coefficients back into full arrays.
+     */
+    void expand(std::vector<float> &e, std::vector<float> &f, std::vector<float> &g,
+                std::vector<float> &h, std::vector<float> &m, std::vector<float> &n) const;
+
+    /*
+     * @return number of cut-cells in the exception list
+     */
+    long numCutCells() const { return cutCell.size(); }
+
+    /*
+     * @return memory used by the compressed storage (bytes)
+     */
+    size_t memoryUsage() const;
+
+private:
+
+    int nx, ny, nz;
+    long numcell_cent;
+
+    std::vector<unsigned char> mask;    /**< Per cell: bit d set when coefficient d is the full value */
+    std::vector<float> table;           /**< Full coefficient values, 6 per k-level */
+    std::vector<long> cutCell;          /**< Sorted indices of the cut-cells */
+    std::vector<float> cutCoef;         /**< Coefficients of the cut-cells, 6 per cell */
+};
@@ -0,0 +1,295 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "CutCells.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+CutCells::CutCells()
+    : nx( 0 ),
+      ny( 0 ),
+      nz( 0 ),
+      pointStart( 1, 0 ),
+      edgeStart( 1, 0 ),
+      faceStart( 1, 0 )
+{
+}
+
+
+CutCells::CutCells(int nx, int ny, int nz)
+    : nx( nx ),
+      ny( ny ),
+      nz( nz ),
+      columnFirstCut( (nx-1)*(ny-1), -1 ),
+      columnFirstAir( (nx-1)*(ny-1), -1 ),
+      columnStart( (nx-1)*(ny-1), 0 ),
+      pointStart( 1, 0 ),
+      edgeStart( 1, 0 ),
+      faceStart( 1, 0 )
+{
+}
+
+
+void CutCells::setColumn(int i, int j, int firstCut, int firstAir)
+{
+    columnFirstCut[i + j*(nx-1)] = firstCut;
+    columnFirstAir[i + j*(nx-1)] = firstAir;
+}
+
+
+void CutCells::addCutCell(long id, std::vector< Vector3<float> > &cellPoints, std::vector< Edge< int > > &cellEdges,
+                          const int intermed[4][4][2], float cellBot, float cellTop)
+{
+    cellId.push_back(id);
+
+    for (size_t p = 0; p < cellPoints.size(); p++)
+    {
+        Point point = { cellPoints[p][0], cellPoints[p][1], cellPoints[p][2] };
+        points.push_back(point);
+    }
+    pointStart.push_back(points.size());
+
+    for (size_t e = 0; e < cellEdges.size(); e++)
+    {
+        TerrainEdge edge = { cellEdges[e][0], cellEdges[e][1] };
+        edges.push_back(edge);
+    }
+    edgeStart.push_back(edges.size());
+
+    // Points of the faces in the fluid, face by face (a face with 2
+    // points or less is not cut)
+    std::vector< Vector3<float> > face;
+
+    // XZ and YZ faces
+    for (int i = 0; i < 4; i++)
+    {
+        int firstC, secondC;
+        if (i == 0)
+        {
+            firstC = 0;
+            secondC = 3;
+        }
+        else if (i == 1)
+        {
+            firstC = 1;
+            secondC = 2;
+        }
+        else if (i == 2)
+        {
+            firstC = 2;
+            secondC = 3;
+        }
+        else
+        {
+            firstC = 0;
+            secondC = 1;
+        }
+
+        face.clear();
+        if (cellPoints[firstC][2] <= cellTop || cellPoints[secondC][2] <= cellTop)
+        {
+            if (cellPoints[firstC][2] < cellTop)
+            {
+                face.push_back(cellPoints[firstC]);
+                face.push_back( Vector3<float>(cellPoints[firstC][0], cellPoints[firstC][1], cellTop) );
+            }
+            else if (intermed[firstC][secondC][1] == -1)
+            {
+                face.push_back( Vector3<float>(cellPoints[firstC][0], cellPoints[firstC][1], cellTop) );
+            }
+
+            if (cellPoints[secondC][2] < cellTop)
+            {
+                face.push_back(cellPoints[secondC]);
+                face.push_back( Vector3<float>(cellPoints[secondC][0], cellPoints[secondC][1], cellTop) );
+            }
+
+            for (int j = 0; j < 2; j++)
+            {
+                if (intermed[firstC][secondC][j] != -1)
+                {
+                    face.push_back(cellPoints[intermed[firstC][secondC][j]]);
+                }
+            }
+        }
+
+        if (face.size() > 2)
+        {
+            for (size_t p = 0; p < face.size(); p++)
+            {
+                Point point = { face[p][0], face[p][1], face[p][2] };
+                facePoints.push_back(point);
+            }
+        }
+        faceStart.push_back(facePoints.size());
+    }
+
+    // XY faces, bottom then top
+    for (int i = 4; i < 6; i++)
+    {
+        face.clear();
+        for (int j = 0; j < 4; j++)
+        {
+            // At the bottom, the corners on the floor, at the top the
+            // corners under the ceiling
+            if ( (i == 4) ? cellPoints[j][2] <= cellBot : cellPoints[j][2] < cellTop )
+            {
+                face.push_back(cellPoints[j]);
+            }
+        }
+
+        for (int first = 0; first < 3; first++)
+        {
+            for (int second = first + 1; second < 4; second++)
+            {
+                if ((first != 1 || second != 3) && intermed[first][second][i - 4] != -1)
+                {
+                    face.push_back(cellPoints[intermed[first][second][i - 4]]);
+                }
+            }
+        }
+
+        if (face.size() > 2)
+        {
+            for (size_t p = 0; p < face.size(); p++)
+            {
+                Point point = { face[p][0], face[p][1], face[p][2] };
+                facePoints.push_back(point);
+            }
+        }
+        faceStart.push_back(facePoints.size());
+    }
+}
+
+
+void CutCells::append(const CutCells &other)
+{
+    long pointShift = points.size();
+    long edgeShift = edges.size();
+    long faceShift = facePoints.size();
+
+    cellId.insert(cellId.end(), other.cellId.begin(), other.cellId.end());
+    points.insert(points.end(), other.points.begin(), other.points.end());
+    edges.insert(edges.end(), other.edges.begin(), other.edges.end());
+    facePoints.insert(facePoints.end(), other.facePoints.begin(), other.facePoints.end());
+
+    for (size_t c = 1; c < other.pointStart.size(); c++)
+    {
+        pointStart.push_back(other.pointStart[c] + pointShift);
+        edgeStart.push_back(other.edgeStart[c] + edgeShift);
+    }
+    for (size_t f = 1; f < other.faceStart.size(); f++)
+    {
+        faceStart.push_back(other.faceStart[f] + faceShift);
+    }
+}
+
+
+void CutCells::indexColumns()
+{
+    long start = 0;
+    for (int i = 0; i < nx-1; i++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            int col = i + j*(nx-1);
+            columnStart[col] = start;
+            if (columnFirstAir[col] >= 0)
+            {
+                start += columnFirstAir[col] - columnFirstCut[col];
+            }
+        }
+    }
+}
+
+
+float CutCells::getFaceFluidArea(long c, int face) const
+{
+    Span<Point> face_points = getFaceFluidPoints(c, face);
+    if (face_points.size() < 3)
+    {
+        return 0.0;
+    }
+
+    // Coordinates of the points in the plane of the face: faces 0 and 1
+    // are at constant y, faces 2 and 3 at constant x, faces 4 and 5 at
+    // constant z
+    std::vector< std::pair<float, float> > uv(face_points.size());
+    float u_mean = 0.0, v_mean = 0.0;
+    for (long p = 0; p < face_points.size(); p++)
+    {
+        const Point &point = face_points[p];
+        if (face < 2)
+        {
+            uv[p] = std::make_pair(point.x, point.z);
+        }
+        else if (face < 4)
+        {
+            uv[p] = std::make_pair(point.y, point.z);
+        }
+        else
+        {
+            uv[p] = std::make_pair(point.x, point.y);
+        }
+        u_mean += uv[p].first;
+        v_mean += uv[p].second;
+    }
+    u_mean /= uv.size();
+    v_mean /= uv.size();
+
+    // The points are not ordered: sort them by angle around their
+    // center to form the polygon, then use the shoelace formula
+    std::sort(uv.begin(), uv.end(), [u_mean, v_mean](const std::pair<float, float> &a, const std::pair<float, float> &b)
+    {
+        return atan2(a.second - v_mean, a.first - u_mean) < atan2(b.second - v_mean, b.first - u_mean);
+    });
+
+    float area = 0.0;
+    for (size_t p = 0; p < uv.size(); p++)
+    {
+        const std::pair<float, float> &a = uv[p];
+        const std::pair<float, float> &b = uv[(p+1) % uv.size()];
+        area += a.first*b.second - b.first*a.second;
+    }
+    return 0.5*fabs(area);
+}
+
+
+size_t CutCells::memoryUsage() const
+{
+    return (columnFirstCut.size() + columnFirstAir.size())*sizeof(int) +
+        (columnStart.size() + cellId.size() + pointStart.size() + edgeStart.size() + faceStart.size())*sizeof(long) +
+        (points.size() + facePoints.size())*sizeof(Point) + edges.size()*sizeof(TerrainEdge);
+}
@@ -0,0 +1,245 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * Geometry of the terrain cut-cells of the domain.
+ *
+ * Only the cut-cells hold data. The cells of a column below the
+ * terrain are all terrain and the cells above it are all air, so each
+ * column keeps the k of its first cut-cell and of its first air cell.
+ * The points, edges and fluid face points of the cut-cells are stored
+ * one after the other in shared arrays, with the offset of each cell
+ * (compressed sparse rows), and are read through spans, without any
+ * copy.
+ */
+
+#include <vector>
+
+#include "Vector3.h"
+#include "Edge.h"
+
+enum cellType : int {air_CT, terrain_CT};
+enum cellFace : int {faceXZNeg_CF, faceXZPos_CF, faceYZNeg_CF, faceYZPos_CF, faceXYNeg_CF, faceXYPos_CF };
+
+class CutCells
+{
+public:
+
+    struct Point
+    {
+        float x, y, z;
+    };
+
+    /*
+     * Edge between two points of a cut-cell, given by their index in
+     * the points of the cell
+     */
+    struct TerrainEdge
+    {
+        int first, second;
+    };
+
+    /*
+     * Read-only view of a range of one of the arrays
+     */
+    template <typename T>
+    class Span
+    {
+    public:
+        Span(const T *data, long size) : m_data(data), m_size(size) {}
+
+        const T *begin() const { return m_data; }
+        const T *end() const { return m_data + m_size; }
+        long size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        const T &operator[](long i) const { return m_data[i]; }
+
+    private:
+        const T *m_data;
+        long m_size;
+    };
+
+    /*
+     * Empty store, without columns (used to collect the cut-cells of a
+     * part of the domain before appending them)
+     */
+    CutCells();
+
+    /*
+     * Store for a domain of the sizes of WINDSGeneralData (staggered
+     * grid), with no column set.
+     */
+    CutCells(int nx, int ny, int nz);
+
+    /*
+     * Sets the cells of column (i,j) of the levels 1 to nz-2: terrain
+     * below firstCut, cut-cells from firstCut to firstAir-1, and air
+     * from firstAir.
+     */
+    void setColumn(int i, int j, int firstCut, int firstAir);
+
+    /*
+     * Adds a cut-cell from the points and edges of the terrain in the
+     * cell, and computes the points of its faces that are in the fluid.
+     *
+     * @param id -index of the cell in the domain
+     * @param points -points of the terrain in the cell, the 4 corners first
+     * @param edges -edges of the terrain between the points
+     * @param intermed -index of the points between two corners, at the bottom
+     * and the top of the cell (-1 if there is none)
+     * @param cellBot -height of the bottom of the cell
+     * @param cellTop -height of the top of the cell
+     */
+    void addCutCell(long id, std::vector< Vector3<float> > &points, std::vector< Edge< int > > &edges,
+                    const int intermed[4][4][2], float cellBot, float cellTop);
+
+    /*
+     * Appends the cut-cells of another store after the ones of this
+     * store.
+     */
+    void append(const CutCells &other);
+
+    /*
+     * Indexes the cut-cells by column, once all columns are set and
+     * all cut-cells added (in the order of the columns, i then j).
+     */
+    void indexColumns();
+
+    /*
+     * @return number of cut-cells
+     */
+    long numCutCells() const { return cellId.size(); }
+
+    /*
+     * @return index in the domain of cut-cell c
+     */
+    long getCellId(long c) const { return cellId[c]; }
+
+    /*
+     * @return the number of the cut-cell (i,j,k), -1 if it is not a
+     * cut-cell
+     */
+    long find(int i, int j, int k) const
+    {
+        int col = i + j*(nx-1);
+        if (k < columnFirstCut[col] || k >= columnFirstAir[col])
+        {
+            return -1;
+        }
+        return columnStart[col] + k - columnFirstCut[col];
+    }
+
+    /*
+     * @return true if there is air in cell (i,j,k) (air or cut-cell)
+     */
+    bool isAir(int i, int j, int k) const
+    {
+        int col = i + j*(nx-1);
+        return columnFirstAir[col] >= 0 && k >= columnFirstCut[col] && k < nz-1;
+    }
+
+    /*
+     * @return true if there is terrain in cell (i,j,k) (terrain or
+     * cut-cell)
+     */
+    bool isTerrain(int i, int j, int k) const
+    {
+        return k >= 1 && k < columnFirstAir[i + j*(nx-1)];
+    }
+
+    /*
+     * @return true if cell (i,j,k) is both terrain and air
+     */
+    bool isCutCell(int i, int j, int k) const
+    {
+        return find(i, j, k) >= 0;
+    }
+
+    /*
+     * @return the points that form the terrain in cut-cell c
+     */
+    Span<Point> getTerrainPoints(long c) const
+    {
+        return Span<Point>(points.data() + pointStart[c], pointStart[c+1] - pointStart[c]);
+    }
+
+    /*
+     * @return the edges that connect the terrain points of cut-cell c
+     */
+    Span<TerrainEdge> getTerrainEdges(long c) const
+    {
+        return Span<TerrainEdge>(edges.data() + edgeStart[c], edgeStart[c+1] - edgeStart[c]);
+    }
+
+    /*
+     * @return the points of a face of cut-cell c that are in the fluid
+     * (none if the face is not cut)
+     * @param face -the face (cellFace enum)
+     */
+    Span<Point> getFaceFluidPoints(long c, int face) const
+    {
+        long f = 6*c + face % 6;
+        return Span<Point>(facePoints.data() + faceStart[f], faceStart[f+1] - faceStart[f]);
+    }
+
+    /*
+     * @return the area of the part of a face of cut-cell c that is in
+     * the fluid (0 if the face has no fluid points)
+     * @param face -the face (cellFace enum)
+     */
+    float getFaceFluidArea(long c, int face) const;
+
+    /*
+     * @return memory used by the store in bytes
+     */
+    size_t memoryUsage() const;
+
+private:
+
+    int nx, ny, nz;
+
+    // Columns, (nx-1)*(ny-1), -1 for the columns not set
+    std::vector<int> columnFirstCut;        /**< k of the first cut-cell */
+    std::vector<int> columnFirstAir;        /**< k of the first air cell */
+    std::vector<long> columnStart;          /**< Number of the first cut-cell */
+
+    std::vector<long> cellId;               /**< Index in the domain of each cut-cell */
+    std::vector<long> pointStart;           /**< First point of each cut-cell, numCutCells()+1 */
+    std::vector<Point> points;
+    std::vector<long> edgeStart;            /**< First edge of each cut-cell, numCutCells()+1 */
+    std::vector<TerrainEdge> edges;
+    std::vector<long> faceStart;            /**< First point of each face, 6*numCutCells()+1 */
+    std::vector<Point> facePoints;
+};
@@ -33,6 +33,11 @@
 
 #include "DTEHeightField.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
 #define PBSTR "||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||"
 #define PBWIDTH 60
 #define LIMIT 99999999.0f
@@ -44,9 +49,10 @@ DTEHeightField::DTEHeightField()
 
 }
 
-DTEHeightField::DTEHeightField(const std::string &filename, double cellSizeXN, double cellSizeYN, float UTMx, float UTMy, int OriginFlag, float DEMDistanceX, float DEMDistanceY, int nx, int ny)
+DTEHeightField::DTEHeightField(const std::string &filename, double cellSizeXN, double cellSizeYN, float UTMx, float UTMy, int OriginFlag, float DEMDistanceX, float DEMDistanceY, int nx, int ny, bool useOverviews)
   : m_filename(filename), m_rbMin(0.0), cellSizeX(cellSizeXN), cellSizeY(cellSizeYN), domain_UTMx(UTMx), domain_UTMy(UTMy),
-   originFlag(OriginFlag), DEMDistancex(DEMDistanceX), DEMDistancey(DEMDistanceY), domain_nx(nx), domain_ny(ny)
+   originFlag(OriginFlag), DEMDistancex(DEMDistanceX), DEMDistancey(DEMDistanceY), domain_nx(nx), domain_ny(ny),
+   m_useOverviews(useOverviews)
 {
   GDALAllRegister();
 
@@ -58,10 +64,8 @@ DTEHeightField::DTEHeightField(const std::string &filename, double cellSizeXN, d
 
 DTEHeightField::DTEHeightField(const std::vector<double> &heightField, int dimX, int dimY, double cellSizeXN, double cellSizeYN)
 {
-    Triangle *tPtr=0;
-    m_triList.clear();
-
-    Vector3<float> tc0, tc1, tc2;
+    m_poDataset = 0;
+    m_triangles.clear();
 
     std::cout << "DEM Loading from height field\n";
     std::cout << "dimX = " << dimX << ", dimY = " << dimY << std::endl;
@@ -71,49 +75,31 @@ DTEHeightField::DTEHeightField(const std::vector<double> &heightField, int dimX,
     // correct dimensions
 
     int step = cellSizeXN;
-
-    for (float j = 0; j < dimY-1; j+=step) {
-        for (float i = 0; i < dimX-1; i+=step) {
-
-            int idx = j * dimX + i;
-            if (idx > heightField.size() - 1) idx = heightField.size()-1;
-            // std::cout << "(" << i << ", " << j << ") = " << heightField[idx] << std::endl;
-
-            Vector3<float> tv0( i, j, (float)heightField[ idx ] ); // queryHeight( pafScanline, Xpixel,  Yline));
-
-            idx = j * dimX + (i + step);
-            if (idx > heightField.size() - 1) idx = heightField.size()-1;
-            Vector3<float> tv1( i+step, j, (float)heightField[ idx ] ); // queryHeight( pafScanline,  (int)(iXpixel + stepX ), Yline ) );
-
-            idx = (j+step) * dimX + i;
-            if (idx > heightField.size() - 1) idx = heightField.size()-1;
-            Vector3<float> tv2( i, j+step, (float)heightField[ idx] ); // queryHeight( pafScanline, Xpixel, (int)(iYline + stepY) ));
-
-            tPtr = new Triangle( tv0, tv1, tv2 );
-            m_triList.push_back(tPtr);
-
-            idx = (j+step) * dimX + i;
-            if (idx > heightField.size() - 1) idx = heightField.size()-1;
-            Vector3<float> tv3( i, j+step, (float)heightField[ idx ] );// queryHeight( pafScanline,  Xpixel, (int)(iYline + stepY) ) );
-
-            idx = j * dimX + (i+step);
-            if (idx > heightField.size() - 1) idx = heightField.size()-1;
-            Vector3<float> tv4( i+step, j, (float)heightField[ idx ] ); //  queryHeight( pafScanline,  (int)(iXpixel + stepX) , Yline ) );
-
-            idx = (j+step) * dimX + (i+step);
-            if (idx > heightField.size() - 1) idx = heightField.size()-1;
-            Vector3<float> tv5( i+step, j+step, (float)heightField[ idx ] ); // queryHeight( pafScanline, (int)(iXpixel + stepX), (int)(iYline + stepY) ) );
-
-            tPtr = new Triangle( tv3, tv4, tv5 );
-            m_triList.push_back(tPtr);
+    m_stepX = m_stepY = step;
+
+    // Nodes of the mesh, shared by the triangles of the cells around them
+    for (float i = 0; i < dimX-1; i+=step)
+        m_nodeX.push_back(i);
+    for (float j = 0; j < dimY-1; j+=step)
+        m_nodeY.push_back(j);
+
+    if (!m_nodeX.empty() && !m_nodeY.empty()) {
+        m_nodeX.push_back(m_nodeX.back() + step);
+        m_nodeY.push_back(m_nodeY.back() + step);
+
+        m_triangles.reserve(m_nodeX.size()*m_nodeY.size(), 2*(m_nodeX.size()-1)*(m_nodeY.size()-1));
+        for (size_t cj = 0; cj < m_nodeY.size(); cj++) {
+            for (size_t ci = 0; ci < m_nodeX.size(); ci++) {
+                int idx = m_nodeY[cj] * dimX + m_nodeX[ci];
+                if (idx > heightField.size() - 1) idx = heightField.size()-1;
+                m_triangles.addVertex( m_nodeX[ci], m_nodeY[cj], (float)heightField[ idx ] );
+            }
         }
+
+        addGridTriangles();
     }
 
     std::cout << "... completed." << std::endl;
-
-  // At end of loop above, all height field data will have been
-  // converted to a triangle mesh, stored in m_triList.
-
 }
 
 #if 0
@@ -323,28 +309,7 @@ void DTEHeightField::load()
   std::cout << "m_nXSize:  " << m_nXSize << std::endl;
   std::cout << "m_nYSize:  " << m_nYSize << std::endl;
 
-  pafScanline = (float *) CPLMalloc(sizeof(float)*(m_nXSize)*(m_nYSize));
-
-  // rb->RasterIO(GF_Read, 0, 0, xsize, ysize, buffer, xsize, ysize, GDT_Float32, 0, 0);
-  //
-  // CPLErr - CE_Failure if the access fails, otherwise CE_None.
-  CPLErr rasterErr = poBand->RasterIO( GF_Read, shift_x, end_y,
-                                       m_nXSize, m_nYSize,
-                                       pafScanline,
-                                       m_nXSize, m_nYSize, GDT_Float32,
-                                       0, 0 );
-  if (rasterErr == CE_Failure) {
-      std::cerr << "CPL RasterIO failure during DEM loading. Exiting." << std::endl;
-      exit(EXIT_FAILURE);
-  }
-
-
-  Triangle *tPtr=0;
-  m_triList.clear();
-
-  //double xGeo, yGeo;
-  Vector3<float> tc0, tc1, tc2;
-
+  m_triangles.clear();
 
   std::cout << "DEM Loading\n";
 
@@ -352,53 +317,146 @@ void DTEHeightField::load()
   float stepY = cellSizeY / pixelSizeY;
 
   assert(stepX > 0 && stepY > 0);
+  m_stepX = stepX;
+  m_stepY = stepY;
+
+  // Pixels and lines of the nodes of the mesh: the corners of the
+  // cells of step pixels
+  std::vector<float> pixels, lines;
+  for (float iXpixel = 0; iXpixel < m_nXSize-1; iXpixel+=stepX)
+    pixels.push_back(iXpixel);
+  for (float iYline = 0; iYline < m_nYSize-1; iYline+=stepY)
+    lines.push_back(iYline);
+
+  if (!pixels.empty() && !lines.empty())
+  {
+    pixels.push_back(pixels.back() + stepX);
+    lines.push_back(lines.back() + stepY);
 
-  for (float iYline = 0; iYline < m_nYSize-1; iYline+=stepY) {
-    for (float iXpixel = 0; iXpixel < m_nXSize-1; iXpixel+=stepX) {
-
-      int Yline = (int)iYline;
-      int Xpixel = (int)iXpixel;
-
-
-      // For these purposes, pixel refers to the "X" coordinate, while
-      // line refers to the "Z" coordinate
-
-      // turn localized coordinates (Yline and Xpixel) into geo-referenced values.
-      // then use the geo referenced coordinate to lookup the height.
-
-
-//      xGeo = m_geoTransform[0] + Xpixel * m_geoTransform[1];
-//      yGeo = m_geoTransform[3] + Yline * m_geoTransform[5];
+    //These "should" be real unit-based triangles.. hopefully meters..
+    m_nodeX.resize(pixels.size());
+    m_nodeY.resize(lines.size());
+    for (size_t ci = 0; ci < pixels.size(); ci++)
+      m_nodeX[ci] = pixels[ci] * pixelSizeX;
+    for (size_t cj = 0; cj < lines.size(); cj++)
+      m_nodeY[cj] = lines[cj] * pixelSizeY;
+
+    std::vector<float> heights;
+    readNodeHeights(poBand, pixels, lines, heights);
+
+    // Each node is one vertex, shared by the triangles of the cells
+    // around it
+    m_triangles.reserve(pixels.size()*lines.size(), 2*(pixels.size()-1)*(lines.size()-1));
+    for (size_t cj = 0; cj < lines.size(); cj++)
+    {
+      for (size_t ci = 0; ci < pixels.size(); ci++)
+        m_triangles.addVertex( m_nodeX[ci], m_nodeY[cj], heights[ci + cj*pixels.size()] );
+    }
 
-//height set to y coord, change to z
+    addGridTriangles();
+  }
+  std::cout << std::endl;
 
-    //These "should" be real unit-based triangles.. hopefully meters..
-      Vector3<float> tv0( iXpixel * pixelSizeX,    iYline * pixelSizeY,     queryHeight( pafScanline, Xpixel,  Yline));
-      Vector3<float> tv1( (iXpixel + stepX) * pixelSizeX, iYline * pixelSizeY, queryHeight( pafScanline,  (int)(iXpixel + stepX ), Yline ) );
-      Vector3<float> tv2( iXpixel * pixelSizeX, (iYline + stepY) * pixelSizeY, queryHeight( pafScanline, Xpixel, (int)(iYline + stepY) ));
+  // At end of loop above, all height field data will have been
+  // converted to a triangle mesh, stored in m_triangles.
+}
 
-      tPtr = new Triangle( tv0, tv1, tv2 );
-      m_triList.push_back(tPtr);
+void DTEHeightField::readNodeHeights(GDALRasterBand *poBand, const std::vector<float> &pixels,
+                                     const std::vector<float> &lines, std::vector<float> &heights)
+{
+  int nNodeX = pixels.size();
+  int nNodeY = lines.size();
 
+  // Nodes outside of the loaded part of the DEM get the height of a 0 value
+  heights.assign(nNodeX*nNodeY, convertHeight(0.0f));
 
-      Vector3<float> tv3(  iXpixel * pixelSizeX, (iYline + stepY) * pixelSizeY, queryHeight( pafScanline,  Xpixel, (int)(iYline + stepY) ) );
-     // convertToTexCoord(Yline+step, Xpixel, tc0);
+  // Coarsest overview whose pixels are not larger than the cells
+  GDALRasterBand *band = poBand;
+  double factor = 1.0;
+  if (m_useOverviews)
+  {
+    for (int o = 0; o < poBand->GetOverviewCount(); o++)
+    {
+      GDALRasterBand *overview = poBand->GetOverview(o);
+      double f = (double)poBand->GetXSize() / overview->GetXSize();
+      if (f > factor && f <= m_stepX && f <= m_stepY)
+      {
+        band = overview;
+        factor = f;
+      }
+    }
+    if (band != poBand)
+      printf("\tReading the DEM from its %dx%d overview\n", band->GetXSize(), band->GetYSize());
+  }
 
-      Vector3<float> tv4(  (iXpixel + stepX) * pixelSizeX, iYline * pixelSizeY,  queryHeight( pafScanline,  (int)(iXpixel + stepX) , Yline ) );
-      // convertToTexCoord(Yline, Xpixel+step, tc1);
+  // Columns of the band read for the nodes
+  std::vector<int> nodeCol(nNodeX, -1);
+  int colMin = band->GetXSize(), colMax = -1;
+  for (int ci = 0; ci < nNodeX; ci++)
+  {
+    int j = (int)pixels[ci];
+    if (j >= m_nXSize)
+      continue;
+    nodeCol[ci] = std::min((int)((shift_x + j) / factor), band->GetXSize()-1);
+    colMin = std::min(colMin, nodeCol[ci]);
+    colMax = std::max(colMax, nodeCol[ci]);
+  }
+  if (colMax < 0)
+    return;
+  int width = colMax - colMin + 1;
+
+  int nBlockXSize, nBlockYSize;
+  band->GetBlockSize(&nBlockXSize, &nBlockYSize);
+  int blockRows = std::max(nBlockYSize, 1);
+  int rowBegin = (int)(end_y / factor);
+  int rowEnd = std::min((int)((end_y + m_nYSize - 1) / factor) + 1, band->GetYSize());
+
+  // The lines are counted from the bottom: go through the rows of
+  // nodes from the top of the raster, loading the strip of blocks
+  // that holds each of them
+  std::vector<float> strip;
+  int stripBegin = 0, stripEnd = 0;
+  for (int cj = nNodeY-1; cj >= 0; cj--)
+  {
+    int k = (int)lines[cj];
+    if (k >= m_nYSize)
+      continue;
+    int row = std::min((int)((end_y + m_nYSize-1 - k) / factor), rowEnd-1);
 
-      Vector3<float> tv5(  (iXpixel + stepX) * pixelSizeX,(iYline + stepY) * pixelSizeY, queryHeight( pafScanline, (int)(iXpixel + stepX), (int)(iYline + stepY) ) );
-      // convertToTexCoord(Yline+step, Xpixel+step, tc2);
+    if (row < stripBegin || row >= stripEnd)
+    {
+      stripBegin = std::max((row / blockRows) * blockRows, rowBegin);
+      stripEnd = std::min((row / blockRows + 1) * blockRows, rowEnd);
+      strip.resize((size_t)width*(stripEnd-stripBegin));
+
+      CPLErr rasterErr = band->RasterIO( GF_Read, colMin, stripBegin,
+                                         width, stripEnd-stripBegin,
+                                         strip.data(),
+                                         width, stripEnd-stripBegin, GDT_Float32,
+                                         0, 0 );
+      if (rasterErr == CE_Failure) {
+        std::cerr << "CPL RasterIO failure during DEM loading. Exiting." << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
 
-      tPtr = new Triangle( tv3, tv4, tv5 );
-      m_triList.push_back(tPtr);
+    const float *values = &strip[(size_t)width*(row-stripBegin)];
+    for (int ci = 0; ci < nNodeX; ci++)
+    {
+      if (nodeCol[ci] >= 0)
+        heights[ci + cj*nNodeX] = convertHeight( values[nodeCol[ci]-colMin] - adfMinMax[0] );
     }
-    printProgress((iYline / (float)m_nYSize));
+    printProgress( (float)(nNodeY-cj) / (float)nNodeY );
   }
-  std::cout << std::endl;
+}
 
-  // At end of loop above, all height field data will have been
-  // converted to a triangle mesh, stored in m_triList.
+float DTEHeightField::nodeHeight(float j, float k) const
+{
+  int nNodeX = m_nodeX.size();
+  int nNodeY = m_nodeY.size();
+  int ci = std::max(0, std::min((int)(j / m_stepX + 0.5f), nNodeX-1));
+  int cj = std::max(0, std::min((int)(k / m_stepY + 0.5f), nNodeY-1));
+  return nodeHeights()[ci + cj*nNodeX];
 }
 
 DTEHeightField::~DTEHeightField()
@@ -430,32 +488,23 @@ void DTEHeightField::setDomain(Vector3<int>* domain, Vector3<float>* grid)
         // else
         // std::cout << "in Z...";
 
-      int triListSize = m_triList.size();
+      std::vector<float> &coord = (q == 0) ? m_triangles.x : ((q == 1) ? m_triangles.y : m_triangles.z);
+      int numVertices = coord.size();
 
 #pragma acc parallel loop
-      for (int i = 0; i < triListSize; i++)
+      for (int i = 0; i < numVertices; i++)
       {
-        if ( (*(m_triList[i]->a))[q] >= 0 && (*(m_triList[i]->a))[q] < min[q] )
-          min[q] = (*(m_triList[i]->a))[q];
-        if ( (*(m_triList[i]->b))[q] >= 0 && (*(m_triList[i]->b))[q] < min[q] )
-          min[q] = (*(m_triList[i]->b))[q];
-        if ( (*(m_triList[i]->c))[q] >= 0 && (*(m_triList[i]->c))[q] < min[q] )
-          min[q] = (*(m_triList[i]->c))[q];
-
-        if ( (*(m_triList[i]->a))[q] > max[q] && (*(m_triList[i]->a))[q] < LIMIT)
-          max[q] = (*(m_triList[i]->a))[q];
-        if ( (*(m_triList[i]->b))[q] > max[q] && (*(m_triList[i]->b))[q] < LIMIT)
-          max[q] = (*(m_triList[i]->b))[q];
-        if ( (*(m_triList[i]->c))[q] > max[q] && (*(m_triList[i]->c))[q] < LIMIT)
-          max[q] = (*(m_triList[i]->c))[q];
+        if ( coord[i] >= 0 && coord[i] < min[q] )
+          min[q] = coord[i];
+
+        if ( coord[i] > max[q] && coord[i] < LIMIT)
+          max[q] = coord[i];
       }
 
 #pragma acc parallel loop
-      for (int i = 0; i < triListSize; i++)
+      for (int i = 0; i < numVertices; i++)
       {
-        (*(m_triList[i]->a))[q] -= min[q];
-        (*(m_triList[i]->b))[q] -= min[q];
-        (*(m_triList[i]->c))[q] -= min[q];
+        coord[i] -= min[q];
       }
 
       /*if (q != 2)
@@ -478,6 +527,12 @@ void DTEHeightField::setDomain(Vector3<int>* domain, Vector3<float>* grid)
       // std::cout << " done." << std::endl;
     }
 
+    // Same shift for the node coordinates used by getHeight
+    for (size_t i = 0; i < m_nodeX.size(); i++)
+      m_nodeX[i] -= min[0];
+    for (size_t j = 0; j < m_nodeY.size(); j++)
+      m_nodeY[j] -= min[1];
+
     auto finish = std::chrono::high_resolution_clock::now();  // Finish recording execution time
 
     std::chrono::duration<double> elapsed = finish - start;
@@ -494,64 +549,110 @@ void DTEHeightField::setDomain(Vector3<int>* domain, Vector3<float>* grid)
 
 void DTEHeightField::outputOBJ(std::string s)
 {
-  std::ofstream file;
-  file.open(s.c_str());
-
-  std::vector< Vector3<float>* > verts;
-  std::vector< Vector3<int>* > tris;
-
-  for (int i = 0; i < m_triList.size(); i++)
+  FILE *file = fopen(s.c_str(), "w");
+  if (!file)
   {
+    std::cerr << "[ERROR] Cannot open " << s << " for the terrain output" << std::endl;
+    return;
+  }
 
-    Triangle* t = m_triList[i];
-
-    Vector3<int> *tVs = new Vector3<int>(-1, -1 , -1);
+  // Vertices with the same coordinates are written once
+  std::vector<int> vertexMap, welded;
+  m_triangles.weld(vertexMap, welded);
+  int numVertices = welded.size();
+  int numTriangles = m_triangles.numTriangles();
+  int total = numVertices + numTriangles;
 
-    for (int j = 0; j < verts.size(); j++)
-    {
-      if ( (*(t->a)) == (*verts[j]) )
-        (*tVs)[0] = j + 1;
-      if ( (*(t->b)) == (*verts[j]) )
-        (*tVs)[1] = j + 1;
-      if ( (*(t->c)) == (*verts[j]) )
-        (*tVs)[2] = j + 1;
-    }
+  // The lines are formatted in a buffer written in large blocks
+  const size_t bufferSize = 1 << 20;
+  std::vector<char> buffer(bufferSize + 128);
+  size_t used = 0;
 
-    if ((*tVs)[0] == -1)
+  for (int i = 0; i < numVertices; i++)
+  {
+    int v = welded[i];
+    used += snprintf(&buffer[used], 128, "v %g %g %g\n", m_triangles.x[v], m_triangles.y[v], m_triangles.z[v]);
+    if (used >= bufferSize)
     {
-      verts.push_back( t->a );
-      (*tVs)[0] = verts.size();
+      fwrite(&buffer[0], 1, used, file);
+      used = 0;
+      printProgress( (float)i / (float)total );
     }
+  }
 
-    if ((*tVs)[1] == -1)
+  for (int i = 0; i < numTriangles; i++)
+  {
+    used += snprintf(&buffer[used], 128, "f %d %d %d\n", vertexMap[m_triangles.corners[3*i]] + 1,
+                     vertexMap[m_triangles.corners[3*i+1]] + 1, vertexMap[m_triangles.corners[3*i+2]] + 1);
+    if (used >= bufferSize)
     {
-      verts.push_back( t->b );
-      (*tVs)[1] = verts.size();
+      fwrite(&buffer[0], 1, used, file);
+      used = 0;
+      printProgress( (float)(numVertices + i) / (float)total );
     }
+  }
+  fwrite(&buffer[0], 1, used, file);
+  printProgress(1.0f);
+  std::cout << std::endl;
 
-    if ((*tVs)[2] == -1)
-    {
-      verts.push_back( t->c );
-      (*tVs)[2] = verts.size();
-    }
+  fclose(file);
+}
 
-    tris.push_back(tVs);
-    printProgress( ( (float)i / (float)m_triList.size()) * (9.0f / 10.0f) );
+void DTEHeightField::outputPLY(std::string s)
+{
+  FILE *file = fopen(s.c_str(), "wb");
+  if (!file)
+  {
+    std::cerr << "[ERROR] Cannot open " << s << " for the terrain output" << std::endl;
+    return;
   }
 
-  for(int i = 0; i < verts.size(); i++)
+  std::vector<int> vertexMap, welded;
+  m_triangles.weld(vertexMap, welded);
+  int numVertices = welded.size();
+  int numTriangles = m_triangles.numTriangles();
+
+  // The binary PLY data is written in the byte order of the machine
+  uint16_t order = 1;
+  bool littleEndian = *(reinterpret_cast<uint8_t *>(&order)) == 1;
+  fprintf(file, "ply\nformat %s 1.0\ncomment QES-Winds terrain\n"
+          "element vertex %d\nproperty float x\nproperty float y\nproperty float z\n"
+          "element face %d\nproperty list uchar int vertex_indices\nend_header\n",
+          littleEndian ? "binary_little_endian" : "binary_big_endian", numVertices, numTriangles);
+
+  const int block = 65536;
+  std::vector<float> vertices;
+  vertices.reserve(3 * block);
+  for (int i = 0; i < numVertices; i += block)
   {
-    file << "v " << (*(verts[i]))[0] << " " << (*(verts[i]))[1] << " " << (*(verts[i]))[2] << "\n";
-    printProgress( ( (float)i / (float)m_triList.size()) / 20.0f + 0.9f );
+    vertices.clear();
+    for (int v = i; v < std::min(i + block, numVertices); v++)
+    {
+      vertices.push_back(m_triangles.x[welded[v]]);
+      vertices.push_back(m_triangles.y[welded[v]]);
+      vertices.push_back(m_triangles.z[welded[v]]);
+    }
+    fwrite(&vertices[0], sizeof(float), vertices.size(), file);
   }
 
-  for(int i = 0; i < tris.size(); i++)
+  // Each face is a count (uchar 3) and 3 ints, without padding
+  const int faceSize = 1 + 3 * sizeof(int);
+  std::vector<char> faces((size_t)block * faceSize);
+  for (int i = 0; i < numTriangles; i += block)
   {
-    file << "f " << (*(tris[i]))[0] << " " << (*(tris[i]))[1] << " " << (*(tris[i]))[2] << "\n";
-    printProgress( ( (float)i / (float)m_triList.size()) / 20.0f + 0.95f);
+    int count = std::min(block, numTriangles - i);
+    for (int t = 0; t < count; t++)
+    {
+      char *face = &faces[(size_t)t * faceSize];
+      int corners[3] = { vertexMap[m_triangles.corners[3*(i+t)]], vertexMap[m_triangles.corners[3*(i+t)+1]],
+                         vertexMap[m_triangles.corners[3*(i+t)+2]] };
+      face[0] = 3;
+      memcpy(face + 1, corners, sizeof(corners));
+    }
+    fwrite(&faces[0], faceSize, count, file);
   }
 
-  file.close();
+  fclose(file);
 }
 
 void DTEHeightField::printProgress (float percentage)
@@ -568,19 +669,24 @@ void DTEHeightField::printProgress (float percentage)
 #define CELL(i,j,k) ((i) + (j) * (nx - 1) + (k) * (nx - 1) * (ny - 1))
 #define CLAMP(low, high, x) ( (x) < (low) ? (low) : ( (x) > (high) ? (high) : (x) ))
 
-std::vector<int> DTEHeightField::setCells(Cell* cells, int nx, int ny, int nz, float dx, float dy, std::vector<float> &dz_array, std::vector<float> z_face, float halo_x, float halo_y) const
+void DTEHeightField::setCells(CutCells &cutCells, int nx, int ny, int nz, float dx, float dy, std::vector<float> &dz_array, std::vector<float> z_face, float halo_x, float halo_y) const
 {
 
   printf("Setting Cell Data...\n");
   auto start = std::chrono::high_resolution_clock::now(); // Start recording execution time
 
-  std::vector<int> cutCells;
+  cutCells = CutCells(nx, ny, nz);
+
+  // The columns are independent: each value of i keeps its own
+  // cut-cells, appended in the order of the serial loop at the end
+  std::vector<CutCells> cutCellsI(nx - 2);
 
   int ii = halo_x/dx;
 	int jj = halo_y/dy;
 	int i_domain_end = ii+(m_nXSize*pixelSizeX)/dx;
 	int j_domain_end = jj+(m_nYSize*pixelSizeY)/dy;
 
+#pragma omp parallel for schedule(dynamic)
   for (int i = 0; i < nx - 2; i++)
     for (int j = 0; j < ny - 2; j++)
     {
@@ -590,10 +696,10 @@ std::vector<int> DTEHeightField::setCells(Cell* cells, int nx, int ny, int nz, f
        Vector3<float> corners[4]; //stored from top Left in clockwise order
        if (i >= ii && j >= jj && i <= i_domain_end && j <= j_domain_end)
        {
-         corners[0] = Vector3<float>( i * dx, j * dy, CLAMP(0, max[2], queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]) );
-         corners[1] = Vector3<float>( i * dx, (j+1) * dy, CLAMP(0, max[2], queryHeight( pafScanline,  ( (i-ii) * dx)/ pixelSizeX, (((j-jj) + 1) * dy) / pixelSizeY) - min[2]) );
-         corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, CLAMP(0, max[2], queryHeight( pafScanline , (((i-ii) + 1) * dx) / pixelSizeX,  (((j-jj) + 1) * dy) / pixelSizeY) - min[2]) );
-         corners[3] = Vector3<float>( (i + 1) * dx, j * dy, CLAMP(0, max[2], queryHeight( pafScanline, (((i-ii) + 1) * dx) / pixelSizeX, ((j-jj) * dy) / pixelSizeY ) - min[2]) );
+         corners[0] = Vector3<float>( i * dx, j * dy, CLAMP(0, max[2], nodeHeight( ((i-ii) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY)) );
+         corners[1] = Vector3<float>( i * dx, (j+1) * dy, CLAMP(0, max[2], nodeHeight( ( (i-ii) * dx)/ pixelSizeX, (((j-jj) + 1) * dy) / pixelSizeY)) );
+         corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, CLAMP(0, max[2], nodeHeight( (((i-ii) + 1) * dx) / pixelSizeX,  (((j-jj) + 1) * dy) / pixelSizeY)) );
+         corners[3] = Vector3<float>( (i + 1) * dx, j * dy, CLAMP(0, max[2], nodeHeight( (((i-ii) + 1) * dx) / pixelSizeX, ((j-jj) * dy) / pixelSizeY)) );
        }
        else
        {
@@ -606,25 +712,25 @@ std::vector<int> DTEHeightField::setCells(Cell* cells, int nx, int ny, int nz, f
        {
          if (j < jj)
          {
-           //std::cout << "height:  " << queryHeight( pafScanline , ( dx) / pixelSizeX,  ( dy) / pixelSizeY) - min[2] << std::endl;
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ( dx) / pixelSizeX,  ( dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , ( dx) / pixelSizeX,  ( dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
+           //std::cout << "height:  " << nodeHeight( ( dx) / pixelSizeX,  ( dy) / pixelSizeY) << std::endl;
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ( dx) / pixelSizeX,  ( dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( ( dx) / pixelSizeX,  ( dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( (dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( (dx) / pixelSizeX,  (dy) / pixelSizeY));
          }
          else if (j > j_domain_end)
          {
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ( dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ( dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( (dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( (dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( (dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
          }
          else
          {
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( (dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
          }
        }
 
@@ -632,17 +738,17 @@ std::vector<int> DTEHeightField::setCells(Cell* cells, int nx, int ny, int nz, f
        {
          if (i > i_domain_end)
          {
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  (dy) / pixelSizeY));
          }
          else
          {
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY) - min[2]);
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( ((i-ii) * dx) / pixelSizeX,  (dy) / pixelSizeY));
          }
        }
 
@@ -650,26 +756,26 @@ std::vector<int> DTEHeightField::setCells(Cell* cells, int nx, int ny, int nz, f
        {
          if (j > j_domain_end)
          {
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
          }
          else
          {
-           corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
-           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , ( (i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
-           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
-           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY) - min[2]);
+           corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
+           corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( ( (i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
+           corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
+           corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( ((i_domain_end-ii-1) * dx) / pixelSizeX,  ( (j-jj) * dy) / pixelSizeY));
          }
        }
 
        else if (j > j_domain_end)
        {
-         corners[0] = Vector3<float>( i * dx, j * dy,   queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-         corners[1] = Vector3<float>( i * dx, (j + 1) * dy, queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-         corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
-         corners[3] = Vector3<float>( (i + 1) * dx, j * dy, queryHeight( pafScanline , ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY) - min[2]);
+         corners[0] = Vector3<float>( i * dx, j * dy,   nodeHeight( ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+         corners[1] = Vector3<float>( i * dx, (j + 1) * dy, nodeHeight( ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+         corners[2] = Vector3<float>( (i + 1) * dx, (j + 1) * dy, nodeHeight( ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
+         corners[3] = Vector3<float>( (i + 1) * dx, j * dy, nodeHeight( ((i-ii) * dx) / pixelSizeX,  ( (j_domain_end-jj-1) * dy) / pixelSizeY));
        }
 
        if (i==319 && j==10)
@@ -683,21 +789,25 @@ std::vector<int> DTEHeightField::setCells(Cell* cells, int nx, int ny, int nz, f
          std::cout << "corners[3]:  " << corners[3][2] << std::endl;
        }*/
 
-       setCellPoints(cells, i, j, nx, ny, nz, dz_array, z_face, corners, cutCells);
+       int firstCut, firstAir;
+       setCellPoints(cutCellsI[i], i, j, nx, ny, nz, dz_array, z_face, corners, firstCut, firstAir);
+       cutCells.setColumn(i, j, firstCut, firstAir);
 
     }
 
+  for (size_t i = 0; i < cutCellsI.size(); i++)
+    cutCells.append(cutCellsI[i]);
+  cutCells.indexColumns();
+
 
   auto finish = std::chrono::high_resolution_clock::now();  // Finish recording execution time
   std::chrono::duration<float> elapsed = finish - start;
   std::cout << "Elapsed time For CellSet: " << elapsed.count() << " s\n";   // Print out elapsed execution time
 
-  return cutCells;
-
 
 }
 
-void DTEHeightField::setCellPoints(Cell* cells, int i, int j, int nx, int ny, int nz, std::vector<float> &dz_array, std::vector<float> z_face, Vector3<float> corners[], std::vector<int>& cutCells) const
+void DTEHeightField::setCellPoints(CutCells &cutCells, int i, int j, int nx, int ny, int nz, const std::vector<float> &dz_array, const std::vector<float> &z_face, Vector3<float> corners[], int &firstCut, int &firstAir) const
 {
    float coordsMin, coordsMax;
    coordsMin = coordsMax = corners[0][2];
@@ -713,7 +823,9 @@ void DTEHeightField::setCellPoints(Cell* cells, int i, int j, int nx, int ny, in
 		}
 	}
 
-// #pragma acc parallel loop
+  firstCut = 1;
+  firstAir = nz - 1;
+
   for (int k = 1; k < nz - 1; k++)
   {
     float cellBot = z_face[k-1];
@@ -726,15 +838,17 @@ void DTEHeightField::setCellPoints(Cell* cells, int i, int j, int nx, int ny, in
       std::cout << "k: " << k << "\t\t" << "coordsMin:  " << coordsMin << std::endl;
     }*/
 
+    // The terrain cells are at the bottom of the column, then the
+    // cut-cells and the air cells
     if ( cellTop <= coordsMin)
-      cells[CELL(i,j,k)] = Cell(terrain_CT, Vector3<float>(corners[0][0], corners[0][1], cellBot),
-                                            Vector3<float>(corners[1][0] - corners[0][0], corners[0][1] - corners[3][1], dz_array[k]));
+      firstCut = k + 1;
     else if ( cellBot >= coordsMax)
-      cells[CELL(i,j,k)] = Cell(air_CT, Vector3<float>(corners[0][0], corners[0][1], cellBot),
-                                            Vector3<float>(corners[1][0] - corners[0][0], corners[0][1] - corners[3][1], dz_array[k]));
+    {
+      firstAir = k;
+      return;
+    }
     else
     {
-      cutCells.push_back(CELL(i,j,k));
 	 /* std::cout << "i:" << i <<"\n";
 	  std::cout << "j:" << j <<"\n";
 	  std::cout << "k:" << k <<"\n";
@@ -1007,9 +1121,7 @@ void DTEHeightField::setCellPoints(Cell* cells, int i, int j, int nx, int ny, in
              * also should not matter.
              */
 
-        cells[CELL(i,j,k)] = Cell(pointsInCell, edgesInCell, intermed,
-                                            Vector3<float>(corners[0][0], corners[0][1], cellBot),
-                                            Vector3<float>(corners[1][0] - corners[0][0], corners[0][1] - corners[3][1], dz_array[k]));
+        cutCells.addCutCell(CELL(i,j,k), pointsInCell, edgesInCell, intermed, cellBot, cellTop);
       }
     }
 }
@@ -1050,5 +1162,246 @@ Vector3<float> DTEHeightField::getIntermediate(Vector3<float> a, Vector3<float>
 
 void DTEHeightField::closeScanner()
 {
-  CPLFree(pafScanline);
+  if (m_poDataset)
+  {
+    GDALClose(m_poDataset);
+    m_poDataset = 0;
+  }
+}
+
+bool DTEHeightField::findInterval(const std::vector<float> &nodes, float v, int &first, int &last)
+{
+  int n = nodes.size();
+  if (n < 2 || !(v >= nodes[0] && v <= nodes[n-1]))
+    return false;
+
+  // The nodes are (nearly) evenly spaced: start from the interval
+  // found by scaling and correct it
+  int k = (int)((v - nodes[0]) / (nodes[n-1] - nodes[0]) * (n-1));
+  k = (k < 0) ? 0 : ((k > n-2) ? n-2 : k);
+  while (k > 0 && nodes[k] > v)
+    k--;
+  while (k < n-2 && nodes[k+1] < v)
+    k++;
+
+  first = (v == nodes[k] && k > 0) ? k-1 : k;
+  last = (v == nodes[k+1] && k < n-2) ? k+1 : k;
+  return true;
+}
+
+float DTEHeightField::getHeight(float x, float y) const
+{
+  int i_first, i_last, j_first, j_last;
+  if (!findInterval(m_nodeX, x, i_first, i_last) || !findInterval(m_nodeY, y, j_first, j_last))
+    return -1.0f;
+
+  // Like the BVH, keep the highest hit of the triangles whose bounding
+  // box contains the point (the cells next to it when it is on an edge)
+  int nNodeX = m_nodeX.size();
+  const std::vector<float> &z = nodeHeights();
+  float height = -1.0f;
+  for (int j = j_first; j <= j_last; j++)
+  {
+    for (int i = i_first; i <= i_last; i++)
+    {
+      const float v00[3] = {m_nodeX[i], m_nodeY[j], z[i + j*nNodeX]};
+      const float v10[3] = {m_nodeX[i+1], m_nodeY[j], z[(i+1) + j*nNodeX]};
+      const float v01[3] = {m_nodeX[i], m_nodeY[j+1], z[i + (j+1)*nNodeX]};
+      const float v11[3] = {m_nodeX[i+1], m_nodeY[j+1], z[(i+1) + (j+1)*nNodeX]};
+
+      // Same triangles (and corner order) as in addGridTriangles()
+      float h = Triangle::getHeightTo(v00, v10, v01, x, y);
+      height = (h > height) ? h : height;
+      h = Triangle::getHeightTo(v01, v10, v11, x, y);
+      height = (h > height) ? h : height;
+    }
+  }
+
+  return height;
+}
+
+void DTEHeightField::addGridTriangles()
+{
+  int nNodeX = m_nodeX.size();
+  int nNodeY = m_nodeY.size();
+
+  // Same triangles and corner order for every cell, row by row
+  for (int cj = 0; cj < nNodeY-1; cj++)
+  {
+    for (int ci = 0; ci < nNodeX-1; ci++)
+    {
+      int v00 = ci + cj*nNodeX;
+      int v10 = v00 + 1;
+      int v01 = v00 + nNodeX;
+      int v11 = v01 + 1;
+
+      m_triangles.addTriangle(v00, v10, v01);
+      m_triangles.addTriangle(v01, v10, v11);
+    }
+  }
+}
+
+bool DTEHeightField::blockFits(int ci, int cj, int size, float maxError) const
+{
+  int nNodeX = m_nodeX.size();
+  const float *z = &m_nodeZ[ci + cj*nNodeX];
+  float z00 = z[0], z10 = z[size], z01 = z[size*nNodeX], z11 = z[size + size*nNodeX];
+
+  // Same triangles as the cells of the grid: (v00, v10, v01) below the
+  // diagonal and (v01, v10, v11) above it
+  for (int b = 0; b <= size; b++)
+  {
+    for (int a = 0; a <= size; a++)
+    {
+      float plane;
+      if (a + b <= size)
+        plane = z00 + (z10 - z00) * a / size + (z01 - z00) * b / size;
+      else
+        plane = z11 + (z01 - z11) * (size - a) / size + (z10 - z11) * (size - b) / size;
+      if (fabs(z[a + b*nNodeX] - plane) > maxError)
+        return false;
+    }
+  }
+  return true;
+}
+
+float DTEHeightField::decimate(float maxError)
+{
+  int nNodeX = m_nodeX.size();
+  int nNodeY = m_nodeY.size();
+  if (maxError <= 0.0f || nNodeX < 2 || nNodeY < 2 || !m_nodeZ.empty())
+    return 0.0f;
+
+  int numTriangles = m_triangles.numTriangles();
+  m_nodeZ.swap(m_triangles.z);
+  m_triangles.clear();
+
+  // Quadtree of the cells: the blocks that stick out of the grid or do
+  // not fit the terrain are split. The fans of the blocks next to
+  // smaller blocks move the mesh by up to the error of the blocks, so
+  // the blocks are fitted within half of the maximum error.
+  struct Block
+  {
+    int ci, cj, size;
+  };
+  int nCellX = nNodeX - 1, nCellY = nNodeY - 1;
+  int rootSize = 1;
+  while (rootSize < std::max(nCellX, nCellY))
+    rootSize *= 2;
+
+  std::vector<Block> blocks, stack(1, Block{0, 0, rootSize});
+  while (!stack.empty())
+  {
+    Block block = stack.back();
+    stack.pop_back();
+    if (block.ci >= nCellX || block.cj >= nCellY)
+      continue;
+
+    if (block.size > 1 && (block.ci + block.size > nCellX || block.cj + block.size > nCellY ||
+                           !blockFits(block.ci, block.cj, block.size, 0.5f * maxError)))
+    {
+      int half = block.size / 2;
+      stack.push_back(Block{block.ci + half, block.cj + half, half});
+      stack.push_back(Block{block.ci, block.cj + half, half});
+      stack.push_back(Block{block.ci + half, block.cj, half});
+      stack.push_back(Block{block.ci, block.cj, half});
+    }
+    else
+    {
+      blocks.push_back(block);
+    }
+  }
+
+  // The corners of the blocks are the vertices, numbered row by row
+  std::vector<int> vertex(nNodeX*nNodeY, -1);
+  for (const Block &block : blocks)
+  {
+    vertex[block.ci + block.cj*nNodeX] = 0;
+    vertex[block.ci + block.size + block.cj*nNodeX] = 0;
+    vertex[block.ci + (block.cj + block.size)*nNodeX] = 0;
+    vertex[block.ci + block.size + (block.cj + block.size)*nNodeX] = 0;
+  }
+  for (int cj = 0; cj < nNodeY; cj++)
+  {
+    for (int ci = 0; ci < nNodeX; ci++)
+    {
+      if (vertex[ci + cj*nNodeX] == 0)
+        vertex[ci + cj*nNodeX] = m_triangles.addVertex(m_nodeX[ci], m_nodeY[cj], m_nodeZ[ci + cj*nNodeX]);
+    }
+  }
+
+  float error = 0.0f;
+  std::vector<int> polygon;
+  for (const Block &block : blocks)
+  {
+    int n00 = block.ci + block.cj*nNodeX;
+    int size = block.size;
+
+    // Each half of the block, with the corners of the smaller blocks
+    // on its two sides of the block, counter-clockwise
+    for (int h = 0; h < 2; h++)
+    {
+      polygon.clear();
+      if (h == 0)
+      {
+        for (int a = 0; a < size; a++)
+          if (vertex[n00 + a] >= 0)
+            polygon.push_back(vertex[n00 + a]);
+        polygon.push_back(vertex[n00 + size]);
+        for (int b = size; b > 0; b--)
+          if (vertex[n00 + b*nNodeX] >= 0)
+            polygon.push_back(vertex[n00 + b*nNodeX]);
+      }
+      else
+      {
+        for (int b = 0; b < size; b++)
+          if (vertex[n00 + size + b*nNodeX] >= 0)
+            polygon.push_back(vertex[n00 + size + b*nNodeX]);
+        for (int a = size; a >= 0; a--)
+          if (vertex[n00 + a + size*nNodeX] >= 0)
+            polygon.push_back(vertex[n00 + a + size*nNodeX]);
+      }
+
+      int first = m_triangles.numTriangles();
+      if (polygon.size() == 3)
+      {
+        // Same corner order as the cells of the grid
+        if (h == 0)
+          m_triangles.addTriangle(polygon[0], polygon[1], polygon[2]);
+        else
+          m_triangles.addTriangle(polygon[2], polygon[0], polygon[1]);
+      }
+      else
+      {
+        // Fan around the center of the half, on the plane of its corners
+        int c0 = (h == 0) ? vertex[n00] : vertex[n00 + size];
+        int c1 = (h == 0) ? vertex[n00 + size] : vertex[n00 + size + size*nNodeX];
+        int c2 = vertex[n00 + size*nNodeX];
+        const std::vector<float> &x = m_triangles.x, &y = m_triangles.y, &z = m_triangles.z;
+        int center = m_triangles.addVertex((x[c0] + x[c1] + x[c2]) / 3.0f, (y[c0] + y[c1] + y[c2]) / 3.0f,
+                                           (z[c0] + z[c1] + z[c2]) / 3.0f);
+        for (size_t p = 0; p < polygon.size(); p++)
+          m_triangles.addTriangle(center, polygon[p], polygon[(p + 1) % polygon.size()]);
+      }
+      int last = m_triangles.numTriangles();
+
+      // Vertical distance between the nodes of the half and its triangles
+      for (int b = 0; b <= size; b++)
+      {
+        for (int a = (h == 0) ? 0 : size - b; a <= ((h == 0) ? size - b : size); a++)
+        {
+          int ci = block.ci + a, cj = block.cj + b;
+          float height = -1.0f;
+          for (int t = first; t < last; t++)
+            height = std::max(height, m_triangles.getHeightTo(t, m_nodeX[ci], m_nodeY[cj]));
+          if (height >= 0.0f)
+            error = std::max(error, (float)fabs(height - m_nodeZ[ci + cj*nNodeX]));
+        }
+      }
+    }
+  }
+
+  printf("\tTerrain mesh decimated from %d to %d triangles (%lu blocks), maximum vertical error %g m\n",
+         numTriangles, m_triangles.numTriangles(), blocks.size(), error);
+  return error;
 }
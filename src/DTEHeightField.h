@@ -36,14 +36,15 @@
 
 
 #include <string>
-#include "Triangle.h"
+#include <vector>
+#include "TrianglePool.h"
 #include "Vector3.h"
 
 #include "gdal_priv.h"
 #include "cpl_conv.h" // for CPLMalloc()
 #include "ogrsf_frmts.h"
 
-#include "Cell.h"
+#include "CutCells.h"
 #include "Edge.h"
 #include <iostream>
 #include <iomanip>
@@ -58,13 +59,23 @@ public:
   friend class test_DTEHeightField;
 
   DTEHeightField();
-  DTEHeightField(const std::string &filename, double cellSizeXN, double cellSizeYN, float UTMx, float UTMy, int OriginFlag, float DEMDistanceX, float DEMDistanceY, int nx, int ny);
+  /*
+   * Loads the part of a DEM file covered by the domain. The DEM is
+   * read in strips of raster blocks and only the pixels of the nodes
+   * of the mesh are kept. With useOverviews, the pixels are read from
+   * the coarsest overview of the file whose pixels are not larger than
+   * the cells, instead of the full resolution raster.
+   */
+  DTEHeightField(const std::string &filename, double cellSizeXN, double cellSizeYN, float UTMx, float UTMy, int OriginFlag, float DEMDistanceX, float DEMDistanceY, int nx, int ny, bool useOverviews = false);
 
     DTEHeightField(const std::vector<double> &heightField, int dimX, int dimY, double cellSizeXN, double cellSizeYN);
 
   ~DTEHeightField();
 
-  std::vector<Triangle*> getTris() const {return m_triList;}
+  /*
+   * Returns the triangles of the terrain mesh
+   */
+  const TrianglePool &getTriangles() const {return m_triangles;}
 
   /*
    * This function takes in a domain to change and a grid size for
@@ -78,39 +89,77 @@ public:
    */
   void setDomain(Vector3<int>* domain, Vector3<float>* grid);
 
+  /*
+   * Simplifies the triangle mesh of the terrain (after setDomain). The
+   * grid of nodes is split in a quadtree of square blocks, and the
+   * blocks where the terrain is within maxError of the two triangles
+   * of their corners are kept as two triangles (split in fans around
+   * their center where smaller blocks touch them, so that the mesh has
+   * no cracks). The heights of the nodes are kept for getHeight and
+   * the cut-cells.
+   *
+   * @param maxError -maximum vertical distance between the nodes and the mesh
+   * @return the largest vertical distance between the nodes and the mesh
+   */
+  float decimate(float maxError);
+
 
   /*
    * This function takes the triangle list that represents the dem file and
-   * outputs the mesh in an obj file format to the file "s"
+   * outputs the mesh in an obj file format to the file "s". The vertices
+   * with the same coordinates are welded (with a hash table) and the
+   * lines are written in large blocks.
    *
    * @param s -The file that the obj data will be written to.
    */
   void outputOBJ(std::string s);
 
   /*
-   * This function takes in a list of cells, and the domain space and queries
-   * the height field at corners of the each cell setting coordinates and the
-   * substances present in each cell. This then returns a list of ints that are
-   * the id's of all cut-cells(cells that are both terrain and air).
+   * Same as outputOBJ, in the binary PLY format, which is much smaller
+   * and faster to write and read for large terrains.
+   *
+   * @param s -The file that the ply data will be written to.
+   */
+  void outputPLY(std::string s);
+
+  /*
+   * This function takes in the domain space and queries the height field
+   * at corners of the each cell, finding the substances present in each
+   * cell and the geometry of the terrain in the cut-cells (cells that
+   * are both terrain and air).
+   * The columns of cells are set in parallel with OpenMP, and the
+   * cut-cells are stored in the same order as with a single thread.
    *
-   * @param cells -The list of cells to be initialized
+   * @param cutCells -The cut-cells of the domain (replaced)
    * @param nx -X dimension in the domain
    * @param ny -Y dimension in the domain
    * @param nz -Z dimension in the domain
    * @param dx -size of a cell in the X axis
    * @param dy -size of a cell in the Y axis
    * @param dz -size of a cell in the Z axis
-   * @return -A list of ID values for all cut cells.
    */
-  std::vector<int> setCells(Cell* cells, int nx, int ny, int nz, float dx, float dy,
+  void setCells(CutCells &cutCells, int nx, int ny, int nz, float dx, float dy,
                             std::vector<float> &dz_array, std::vector<float> z_face,
                             float halo_x, float halo_y) const;
 
   /*
-   * This function frees the pafScanline. It should be called after all DEM querying has taken place.
+   * This function closes the DEM file. It should be called after all DEM querying has taken place.
    */
   void closeScanner();
 
+  /*
+   * This function returns the height of the terrain mesh above a point
+   * of the xy plane. The triangles are found directly from the grid of
+   * mesh nodes, and the height is the same as the one of a ray cast
+   * through the BVH of the mesh (Mesh::getHeight), unless the mesh has
+   * been decimated.
+   *
+   * @param x -x position
+   * @param y -y position
+   * @return the height of the terrain, -1 outside of the mesh
+   */
+  float getHeight(float x, float y) const;
+
     void convertRasterToGeo( double rasterX, double rasterY, double &geoX, double &geoY )
     {
         // Affine transformation from the GDAL geotransform:
@@ -131,8 +180,8 @@ private:
   /*
    * This function is given the height of the DEM file at each of it's corners and uses
    * them to calculate at what points cells are intersected by the quad the corners form.
-   * the cells are then updated to reflect the cut.
-   * @param cells -The list of cells to be initialized
+   * the cut-cells of the column are added to cutCells.
+   * @param cutCells -The cut-cells found so far
    * @param i -The current x dimension index of the cell
    * @param i -The current y dimension index of the cell
    * @param nx -X dimension in the domain
@@ -140,12 +189,46 @@ private:
    * @param nz -Z dimension in the domain
    * @param dz -size of a cell in the Z axis
    * @param corners -an array containing the points that representing the DEM elevation at each of the cells corners
-   * @param cutCells -a list of all cells which the terrain goes through
+   * @param firstCut -k of the first cell of the column above the terrain cells
+   * @param firstAir -k of the first air cell of the column
    */
-  void setCellPoints(Cell* cells, int i, int j, int nx, int ny, int nz, std::vector<float> &dz_array, std::vector<float> z_face, Vector3<float> corners[], std::vector<int>& cutCells) const;
+  void setCellPoints(CutCells &cutCells, int i, int j, int nx, int ny, int nz, const std::vector<float> &dz_array, const std::vector<float> &z_face, Vector3<float> corners[], int &firstCut, int &firstAir) const;
 
   void load();
 
+  /*
+   * This function finds the intervals of the node coordinates that
+   * contain v: one, or two when v is on a node.
+   *
+   * @param nodes -increasing node coordinates
+   * @param v -the coordinate to locate
+   * @param first -first interval containing v
+   * @param last -last interval containing v
+   * @return false if v is outside of the nodes
+   */
+  static bool findInterval(const std::vector<float> &nodes, float v, int &first, int &last);
+
+  /*
+   * This function adds the two triangles of each cell of the grid of
+   * nodes to m_triangles, once the nodes have been added as vertices.
+   */
+  void addGridTriangles();
+
+  /*
+   * Returns true if the heights of the nodes of the square block of
+   * size cells with its lower corner at node (ci, cj) are within
+   * maxError of the two triangles of its corners.
+   */
+  bool blockFits(int ci, int cj, int size, float maxError) const;
+
+  /*
+   * Heights of the nodes, m_nodeX.size() per row
+   */
+  const std::vector<float> &nodeHeights() const
+  {
+    return m_nodeZ.empty() ? m_triangles.z : m_nodeZ;
+  }
+
   void printProgress (float percentage);
 
   // void loadImage();
@@ -156,23 +239,13 @@ private:
     return fabs( f1 - f2 ) < eps;
   }
 
-  float queryHeight( float *scanline, int j, int k )  const
+  /*
+   * Converts a raster value (minus the minimum of the band) to a
+   * height: negative and NaN values give 0, the no-data value the
+   * minimum height, the others are scaled.
+   */
+  float convertHeight( float height ) const
   {
-    float height;
-    if ( j >= m_nXSize || k >= m_nYSize)
-    {
-      height = 0.0;
-    }
-    //if (j * m_nXSize + k >= m_nXSize * m_nYSize
-    else
-    {
-        // important to remember range is [0, n-1], so need the -1
-        // in the flip
-        // Previous code had this -- does not seem correct
-        // height = scanline[ abs(k-m_nYSize) * m_nXSize + j ];
-        height = scanline[ (m_nYSize-1 - k) * (m_nXSize) + j ] -adfMinMax[0]; 
-    }
-
     if (height < 0.0 || std::isnan(abs(height)))
     {
       height = 0.0;
@@ -191,6 +264,26 @@ private:
     return height;
   }
 
+  /*
+   * Height of the mesh node nearest to pixel j of line k (from the
+   * bottom of the loaded part of the DEM)
+   */
+  float nodeHeight( float j, float k ) const;
+
+  /*
+   * This function reads the heights of the nodes of the mesh, at the
+   * given pixels and lines of the loaded part of the DEM. The rows of
+   * the raster are read in strips of blocks, skipping the strips that
+   * have no node.
+   *
+   * @param poBand -raster band of the DEM
+   * @param pixels -pixels of the columns of nodes
+   * @param lines -lines of the rows of nodes, from the bottom
+   * @param heights -node heights, pixels.size() per row of nodes
+   */
+  void readNodeHeights( GDALRasterBand *poBand, const std::vector<float> &pixels,
+                        const std::vector<float> &lines, std::vector<float> &heights );
+
   /*
    * Given a height between the two points (z value) this function will create
    * a third point which exists on the line from a to b existing at height h.
@@ -228,10 +321,18 @@ private:
   int end_x = 0;
   int end_y = 0;
 
-  std::vector<Triangle*> m_triList;
+  // Triangles of the mesh. Its vertices are the nodes of the grid
+  // below, m_nodeX.size() per row.
+  TrianglePool m_triangles;
   float min[3], max[3];
 
-  float *pafScanline;
+  // Grid of the nodes of the triangle mesh, used by getHeight
+  std::vector<float> m_nodeX, m_nodeY;    // Node coordinates in x and y
+  float m_stepX = 1.0, m_stepY = 1.0;     // Pixels between two nodes
+  std::vector<float> m_nodeZ;             // Node heights once the mesh is decimated (the
+                                          // vertices of m_triangles before)
+
+  bool m_useOverviews = false;            // Read the DEM from its overviews
 
 };
 
@@ -453,12 +453,14 @@ void DynamicParallelism::solve(const WINDSInputData* WID, WINDSGeneralData* WGD,
     cudaMemcpy(d_R,R.data(),WGD->numcell_cent*sizeof(float),cudaMemcpyHostToDevice);
     cudaMemcpy(d_value , value.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
     cudaMemcpy(d_bvalue , bvalue.data() , numblocks * sizeof(float) , cudaMemcpyHostToDevice);
-    cudaMemcpy(d_e , WGD->e.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
-    cudaMemcpy(d_f , WGD->f.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
-    cudaMemcpy(d_g , WGD->g.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
-    cudaMemcpy(d_h , WGD->h.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
-    cudaMemcpy(d_m , WGD->m.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
-    cudaMemcpy(d_n , WGD->n.data() , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
+    // Coefficients as full arrays (expanded if WGD keeps them compressed)
+    loadCoefficients(WGD);
+    cudaMemcpy(d_e , coeff.e , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
+    cudaMemcpy(d_f , coeff.f , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
+    cudaMemcpy(d_g , coeff.g , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
+    cudaMemcpy(d_h , coeff.h , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
+    cudaMemcpy(d_m , coeff.m , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
+    cudaMemcpy(d_n , coeff.n , WGD->numcell_cent * sizeof(float) , cudaMemcpyHostToDevice);
 
 
     cudaMemcpy(d_dz_array , WGD->dz_array.data() , (WGD->nz-1) * sizeof(float) , cudaMemcpyHostToDevice);
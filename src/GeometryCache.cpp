@@ -0,0 +1,220 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "GeometryCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const char cacheMagic[8] = { 'Q', 'E', 'S', 'G', 'E', 'O', 'M', '\0' };
+static const uint32_t cacheVersion = 1;
+
+
+void GeometryCache::Hash::add(const void *data, size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+
+void GeometryCache::Hash::addFile(const std::string &fileName)
+{
+    add(fileName);
+
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        add(buffer.data(), file.gcount());
+    }
+}
+
+
+GeometryCache::GeometryCache(const std::string &directory, uint64_t key)
+    : m_directory(directory),
+      m_key(key)
+{
+    std::ostringstream name;
+    name << directory << "/geometry_" << std::hex << std::setw(16) << std::setfill('0') << key << ".qesgeo";
+    m_fileName = name.str();
+
+    int fd = open(m_fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header))
+    {
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            m_data = static_cast<const char *>(mapping);
+            m_size = st.st_size;
+        }
+    }
+    close(fd);
+
+    if (!m_data)
+    {
+        return;
+    }
+
+    // Check the header and the bounds of the arrays before using the file
+    const Header *header = reinterpret_cast<const Header *>(m_data);
+    if (std::memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+        header->version != cacheVersion || header->key != m_key ||
+        sizeof(Header) + header->sectionCount * sizeof(Section) > m_size)
+    {
+        std::cerr << "[WARNING] Ignoring invalid geometry cache file " << m_fileName << std::endl;
+        unmap();
+        return;
+    }
+
+    m_sections = reinterpret_cast<const Section *>(m_data + sizeof(Header));
+    m_sectionCount = header->sectionCount;
+    for (uint32_t s = 0; s < m_sectionCount; s++)
+    {
+        const Section &section = m_sections[s];
+        if (section.offset > m_size || section.count * section.elementSize > m_size - section.offset)
+        {
+            std::cerr << "[WARNING] Ignoring truncated geometry cache file " << m_fileName << std::endl;
+            unmap();
+            return;
+        }
+    }
+}
+
+
+GeometryCache::~GeometryCache()
+{
+    unmap();
+}
+
+
+void GeometryCache::unmap()
+{
+    if (m_data)
+    {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_sections = nullptr;
+    m_sectionCount = 0;
+}
+
+
+const GeometryCache::Section *GeometryCache::findSection(const std::string &name, size_t elementSize) const
+{
+    for (uint32_t s = 0; s < m_sectionCount; s++)
+    {
+        if (name.compare(0, nameSize - 1, m_sections[s].name) == 0)
+        {
+            return (m_sections[s].elementSize == elementSize) ? &m_sections[s] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+
+bool GeometryCache::write()
+{
+    mkdir(m_directory.c_str(), 0755);
+
+    Header header;
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.sectionCount = m_pending.size();
+    header.key = m_key;
+
+    // Table of the arrays, each one starting on an aligned offset
+    std::vector<Section> sections(m_pending.size());
+    uint64_t offset = sizeof(Header) + sections.size() * sizeof(Section);
+    for (size_t s = 0; s < m_pending.size(); s++)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+
+        std::memset(&sections[s], 0, sizeof(Section));
+        std::strncpy(sections[s].name, m_pending[s].name.c_str(), nameSize - 1);
+        sections[s].offset = offset;
+        sections[s].count = m_pending[s].count;
+        sections[s].elementSize = m_pending[s].elementSize;
+
+        offset += m_pending[s].count * m_pending[s].elementSize;
+    }
+
+    std::string tmpName = m_fileName + ".tmp";
+    std::ofstream file(tmpName.c_str(), std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "[WARNING] Could not write the geometry cache file " << m_fileName << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(sections.data()), sections.size() * sizeof(Section));
+
+    const char padding[alignment] = { 0 };
+    for (size_t s = 0; s < m_pending.size(); s++)
+    {
+        file.write(padding, sections[s].offset - file.tellp());
+        file.write(static_cast<const char *>(m_pending[s].data), m_pending[s].count * m_pending[s].elementSize);
+    }
+    file.close();
+    m_pending.clear();
+
+    if (!file || std::rename(tmpName.c_str(), m_fileName.c_str()) != 0)
+    {
+        std::cerr << "[WARNING] Could not write the geometry cache file " << m_fileName << std::endl;
+        std::remove(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}
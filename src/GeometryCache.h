@@ -0,0 +1,191 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * Binary cache of the preprocessed geometry of the domain.
+ *
+ * The cache file is named after a hash of the inputs of the geometry
+ * (DEM, shapefile, grid and flags), so a run on unchanged geometry
+ * finds the file written by a previous run. The file is a header, a
+ * table of named arrays and the arrays themselves, aligned so that
+ * the file is mapped in memory and the arrays copied directly from
+ * the mapping.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class GeometryCache
+{
+public:
+
+    /*
+     * 64-bit FNV-1a hash of the inputs of the geometry
+     */
+    class Hash
+    {
+    public:
+        void add(const void *data, size_t size);
+
+        template <typename T>
+        void add(const T &value) { add(&value, sizeof(T)); }
+
+        template <typename T>
+        void add(const std::vector<T> &values)
+        {
+            add(values.size());
+            add(values.data(), values.size() * sizeof(T));
+        }
+
+        void add(const std::string &s)
+        {
+            add(s.size());
+            add(s.data(), s.size());
+        }
+
+        /*
+         * Adds the name and the content of a file (only the name if
+         * the file cannot be read)
+         */
+        void addFile(const std::string &fileName);
+
+        uint64_t value() const { return h; }
+
+    private:
+        uint64_t h = 14695981039346656037ULL;
+    };
+
+    /*
+     * Maps the cache file of the key in directory, if it exists and
+     * is valid.
+     *
+     * @param directory -directory of the cache files
+     * @param key -hash of the inputs of the geometry
+     */
+    GeometryCache(const std::string &directory, uint64_t key);
+
+    ~GeometryCache();
+
+    /*
+     * @return true if the cache file of the key has been mapped
+     */
+    bool isLoaded() const { return m_data != nullptr; }
+
+    const std::string &getFileName() const { return m_fileName; }
+
+    /*
+     * Copies an array of the cache file into values.
+     *
+     * @return false if the array is not in the file or its elements
+     * do not have the size of T
+     */
+    template <typename T>
+    bool read(const std::string &name, std::vector<T> &values) const
+    {
+        const Section *section = findSection(name, sizeof(T));
+        if (!section)
+            return false;
+
+        values.resize(section->count);
+        if (section->count > 0)
+            std::memcpy(values.data(), m_data + section->offset, section->count * sizeof(T));
+        return true;
+    }
+
+    /*
+     * Adds an array to the next write of the cache file. The array is
+     * not copied, so it must not change before write().
+     */
+    template <typename T>
+    void add(const std::string &name, const std::vector<T> &values)
+    {
+        Pending p = { name, values.data(), values.size(), sizeof(T) };
+        m_pending.push_back(p);
+    }
+
+    /*
+     * Writes the added arrays to the cache file (through a temporary
+     * file, so another run never maps a partial file).
+     *
+     * @return false if the file could not be written
+     */
+    bool write();
+
+private:
+
+    static const int nameSize = 32;
+    static const int alignment = 64;      // Alignment of the arrays in the file
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t sectionCount;
+        uint64_t key;
+    };
+
+    struct Section
+    {
+        char name[nameSize];
+        uint64_t offset;                  // Offset of the array from the start of the file
+        uint64_t count;                   // Number of elements
+        uint64_t elementSize;
+    };
+
+    struct Pending
+    {
+        std::string name;
+        const void *data;
+        size_t count;
+        size_t elementSize;
+    };
+
+    const Section *findSection(const std::string &name, size_t elementSize) const;
+
+    void unmap();
+
+    std::string m_directory;
+    std::string m_fileName;
+    uint64_t m_key;
+
+    const char *m_data = nullptr;         // Mapping of the cache file
+    size_t m_size = 0;
+    const Section *m_sections = nullptr;
+    uint32_t m_sectionCount = 0;
+
+    std::vector<Pending> m_pending;
+};
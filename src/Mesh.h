@@ -38,7 +38,7 @@
  * represents a connected collection of Triangles
  */
 
-#include "Triangle.h"
+#include "TrianglePool.h"
 #include "BVH.h"
 
 #include <limits>
@@ -61,11 +61,11 @@ public:
         vector<Triangle*> optixTris;
 
 	/*
-	 * Creates a BVH out of a list of Triangles
+	 * Creates a BVH out of a pool of Triangles
 	 *
-	 * @param tris -list of triangles.
+	 * @param tris -pool of triangles.
 	 */
-	Mesh(vector<Triangle*> tris)
+	Mesh(const TrianglePool &tris)
             : mlSampleRate( 100 )
 	{
 		this->tris = BVH::createBVH(tris);
@@ -73,8 +73,6 @@ public:
                 //temp var for Optix
                 // this->optixRayTracer = new OptixRayTrace(tris);
                        //optixTris = tris;
-                //temp var for getting the list of triangles
-                       trisList = tris;
         }
 
 	/*
@@ -87,8 +85,4 @@ public:
 	 */
 	float getHeight(float x, float y);
 
-  private:
-        //temporary variable for getting the list of Triangles though the mesh
-        std::vector<Triangle *> trisList;
-
 };
@@ -0,0 +1,589 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "MultigridSolver.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::cout;
+
+MultigridSolver::MultigridSolver(const WINDSInputData* WID, WINDSGeneralData* WGD)
+    : Solver(WID, WGD), fineSweeps(0)
+{
+}
+
+
+void MultigridSolver::buildLevels(WINDSGeneralData* WGD)
+{
+    levels.clear();
+
+    // Finest level: the interior cells solved by the SOR solvers,
+    // using the coefficient arrays of the solve directly
+    Level fine;
+    fine.lx = WGD->nx-3;
+    fine.ly = WGD->ny-3;
+    fine.lz = WGD->nz-3;
+    fine.fx = fine.fy = fine.fz = 1;
+    fine.px = WGD->nx-1;
+    fine.pxy = (long)(WGD->nx-1)*(WGD->ny-1);
+    fine.e = coeff.e;
+    fine.f = coeff.f;
+    fine.g = coeff.g;
+    fine.h = coeff.h;
+    fine.m = coeff.m;
+    fine.n = coeff.n;
+    fine.b.resize( WGD->numcell_cent, 0.0 );
+    fine.r.resize( WGD->numcell_cent, 0.0 );
+    fine.z.resize( WGD->numcell_cent, 0.0 );
+    fine.scale.resize( WGD->nz-1 );
+    for (int k = 0; k < WGD->nz-1; k++)
+    {
+        fine.scale[k] = WGD->dx*WGD->dy*WGD->dz_array[k];
+    }
+    fine.active.resize( WGD->numcell_cent, 0 );
+    for (long id = 0; id < WGD->numcell_cent; id++)
+    {
+        fine.active[id] = (WGD->icellflag[id] != 0 && WGD->icellflag[id] != 2);
+    }
+    fine.spans = WGD->activeCells;
+    levels.push_back(fine);
+
+    // Coarsen until there is nothing left worth coarsening
+    while (true)
+    {
+        const Level &F = levels.back();
+        Level C;
+        C.fx = (F.lx > 2) ? 2 : 1;
+        C.fy = (F.ly > 2) ? 2 : 1;
+        C.fz = (F.lz > 2) ? 2 : 1;
+        if ((C.fx == 1 && C.fy == 1 && C.fz == 1) || (long)F.lx*F.ly*F.lz < 64)
+        {
+            break;
+        }
+        C.lx = (F.lx + C.fx - 1)/C.fx;
+        C.ly = (F.ly + C.fy - 1)/C.fy;
+        C.lz = (F.lz + C.fz - 1)/C.fz;
+        C.px = C.lx+2;
+        C.pxy = C.px*(C.ly+2);
+
+        long size = C.pxy*(C.lz+2);
+        C.ce.resize( size, 0.0 );
+        C.cf.resize( size, 0.0 );
+        C.cg.resize( size, 0.0 );
+        C.ch.resize( size, 0.0 );
+        C.cm.resize( size, 0.0 );
+        C.cn.resize( size, 0.0 );
+        C.x.resize( size, 0.0 );
+        C.b.resize( size, 0.0 );
+        C.r.resize( size, 0.0 );
+        C.z.resize( size, 0.0 );
+        C.scale.resize( C.lz+2, 1.0 );       // coarse equations are already volume integrated
+        C.active.resize( size, 0 );
+
+        // Sum the conductances of the faces between fluid cells that
+        // belong to different coarse cells.  Links to the ghost layer
+        // are Dirichlet conditions and are kept.  With piecewise
+        // constant interpolation this is the Galerkin coarse operator.
+        for (int k = 1; k <= F.lz; k++)
+        {
+            for (int j = 1; j <= F.ly; j++)
+            {
+                for (int i = 1; i <= F.lx; i++)
+                {
+                    long id = F.index(i,j,k);
+                    if (!F.active[id])
+                    {
+                        continue;
+                    }
+                    int I = (i-1)/C.fx+1, J = (j-1)/C.fy+1, K = (k-1)/C.fz+1;
+                    long idc = C.index(I,J,K);
+                    float vol = F.scale[k];
+                    C.active[idc] = 1;
+
+                    if (i == F.lx)
+                    {
+                        C.ce[idc] += F.e[id]*vol;
+                    }
+                    else if (F.active[id+1] && (i/C.fx+1) != I)
+                    {
+                        C.ce[idc] += F.e[id]*vol;
+                        C.cf[idc+1] += F.e[id]*vol;
+                    }
+                    if (i == 1)
+                    {
+                        C.cf[idc] += F.f[id]*vol;
+                    }
+
+                    if (j == F.ly)
+                    {
+                        C.cg[idc] += F.g[id]*vol;
+                    }
+                    else if (F.active[id+F.px] && (j/C.fy+1) != J)
+                    {
+                        C.cg[idc] += F.g[id]*vol;
+                        C.ch[idc+C.px] += F.g[id]*vol;
+                    }
+                    if (j == 1)
+                    {
+                        C.ch[idc] += F.h[id]*vol;
+                    }
+
+                    if (k == F.lz)
+                    {
+                        C.cm[idc] += F.m[id]*vol;
+                    }
+                    else if (F.active[id+F.pxy] && (k/C.fz+1) != K)
+                    {
+                        C.cm[idc] += F.m[id]*vol;
+                        C.cn[idc+C.pxy] += F.m[id]*vol;
+                    }
+                    if (k == 1)
+                    {
+                        C.cn[idc] += F.n[id]*vol;
+                    }
+                }
+            }
+        }
+
+        // Point the new level to its own storage (the vectors are moved,
+        // not copied, when the level list grows so this stays valid)
+        levels.push_back(std::move(C));
+        Level &L = levels.back();
+        L.e = L.ce.data();
+        L.f = L.cf.data();
+        L.g = L.cg.data();
+        L.h = L.ch.data();
+        L.m = L.cm.data();
+        L.n = L.cn.data();
+        L.xp = L.x.data();
+    }
+
+    levels[0].xp = lambda.data();
+}
+
+
+void MultigridSolver::smooth(Level &L, int sweeps)
+{
+    float *x = L.xp;
+    const float *b = L.b.data();
+
+    for (int s = 0; s < sweeps; s++)
+    {
+        for (int color = 0; color < 2; color++)
+        {
+#pragma omp parallel for collapse(2) schedule(static)
+            for (int k = 1; k <= L.lz; k++)
+            {
+                for (int j = 1; j <= L.ly; j++)
+                {
+                    // The fine level only visits the spans of fluid cells,
+                    // the coarse levels the whole row
+                    int s_begin = (L.spans != nullptr) ? L.spans->rowBegin(j,k) : 0;
+                    int s_end = (L.spans != nullptr) ? L.spans->rowEnd(j,k) : 1;
+                    for (int s = s_begin; s < s_end; s++)
+                    {
+                        int i_first = (L.spans != nullptr) ? MAX_S(1, L.spans->spanStart[s]) : 1;
+                        int i_last = (L.spans != nullptr) ? MIN_S(L.lx, L.spans->spanEnd[s]-1) : L.lx;
+
+                        // first i that belongs to the current color
+                        int i_start = i_first + ((i_first + j + k + color) & 1);
+                        for (int i = i_start; i <= i_last; i += 2)
+                        {
+                            long id = L.index(i,j,k);
+                            float diag = L.e[id] + L.f[id] + L.g[id] + L.h[id] + L.m[id] + L.n[id];
+                            if (!L.active[id] || diag == 0.0)
+                            {
+                                continue;           // solid cell or cut off from the fluid
+                            }
+                            x[id] = ( L.e[id]*x[id+1]     + L.f[id]*x[id-1] +
+                                      L.g[id]*x[id+L.px]  + L.h[id]*x[id-L.px] +
+                                      L.m[id]*x[id+L.pxy] + L.n[id]*x[id-L.pxy] + b[id] ) / diag;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void MultigridSolver::residual(Level &L)
+{
+    const float *x = L.xp;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k <= L.lz; k++)
+    {
+        for (int j = 1; j <= L.ly; j++)
+        {
+            for (int i = 1; i <= L.lx; i++)
+            {
+                long id = L.index(i,j,k);
+                float diag = L.e[id] + L.f[id] + L.g[id] + L.h[id] + L.m[id] + L.n[id];
+                L.r[id] = L.b[id] - diag*x[id] +
+                    ( L.e[id]*x[id+1]     + L.f[id]*x[id-1] +
+                      L.g[id]*x[id+L.px]  + L.h[id]*x[id-L.px] +
+                      L.m[id]*x[id+L.pxy] + L.n[id]*x[id-L.pxy] );
+            }
+        }
+    }
+}
+
+
+void MultigridSolver::restrictResidual(int l)
+{
+    const Level &F = levels[l];
+    Level &C = levels[l+1];
+
+    std::fill(C.b.begin(), C.b.end(), 0.0);
+
+    // Each coarse cell only gathers from its own children, so the
+    // coarse k-levels can be processed concurrently
+#pragma omp parallel for schedule(static)
+    for (int K = 1; K <= C.lz; K++)
+    {
+        for (int k = (K-1)*C.fz+1; k <= MIN_S(K*C.fz, F.lz); k++)
+        {
+            for (int j = 1; j <= F.ly; j++)
+            {
+                for (int i = 1; i <= F.lx; i++)
+                {
+                    long id = F.index(i,j,k);
+                    if (F.active[id])
+                    {
+                        C.b[C.index((i-1)/C.fx+1, (j-1)/C.fy+1, K)] += F.scale[k]*F.r[id];
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void MultigridSolver::prolongate(int l)
+{
+    Level &F = levels[l];
+    const Level &C = levels[l+1];
+    float *x = F.xp;
+
+    // Interpolate the coarse solution to the fluid cells
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k <= F.lz; k++)
+    {
+        for (int j = 1; j <= F.ly; j++)
+        {
+            for (int i = 1; i <= F.lx; i++)
+            {
+                long id = F.index(i,j,k);
+                F.z[id] = F.active[id] ? C.xp[C.index((i-1)/C.fx+1, (j-1)/C.fy+1, (k-1)/C.fz+1)] : 0.0;
+            }
+        }
+    }
+
+    // Piecewise constant interpolation gets the shape of the correction
+    // right but not its size, so scale it to minimize the energy of the
+    // error: alpha = (r,z)/(z,Az) using the volume weighted products
+    double num = 0.0, den = 0.0;
+#pragma omp parallel for collapse(2) schedule(static) reduction(+:num,den)
+    for (int k = 1; k <= F.lz; k++)
+    {
+        for (int j = 1; j <= F.ly; j++)
+        {
+            for (int i = 1; i <= F.lx; i++)
+            {
+                long id = F.index(i,j,k);
+                if (F.active[id])
+                {
+                    const float *z = F.z.data();
+                    float diag = F.e[id] + F.f[id] + F.g[id] + F.h[id] + F.m[id] + F.n[id];
+                    float Az = diag*z[id] -
+                        ( F.e[id]*z[id+1]     + F.f[id]*z[id-1] +
+                          F.g[id]*z[id+F.px]  + F.h[id]*z[id-F.px] +
+                          F.m[id]*z[id+F.pxy] + F.n[id]*z[id-F.pxy] );
+                    num += F.scale[k]*F.r[id]*z[id];
+                    den += F.scale[k]*z[id]*Az;
+                }
+            }
+        }
+    }
+    float alpha = (den > 0.0) ? num/den : 0.0;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k <= F.lz; k++)
+    {
+        for (int j = 1; j <= F.ly; j++)
+        {
+            for (int i = 1; i <= F.lx; i++)
+            {
+                long id = F.index(i,j,k);
+                if (F.active[id])
+                {
+                    x[id] += alpha*F.z[id];
+                }
+            }
+        }
+    }
+}
+
+
+void MultigridSolver::vCycle(int l)
+{
+    Level &L = levels[l];
+
+    if (l == (int)levels.size()-1)
+    {
+        smooth(L, coarseSweeps);
+        return;
+    }
+
+    smooth(L, preSweeps);
+    if (l == 0)
+    {
+        fineSweeps += preSweeps;
+    }
+
+    residual(L);
+    restrictResidual(l);
+    std::fill(levels[l+1].x.begin(), levels[l+1].x.end(), 0.0);
+    vCycle(l+1);
+    prolongate(l);
+
+    smooth(L, postSweeps);
+    if (l == 0)
+    {
+        fineSweeps += postSweeps;
+    }
+}
+
+
+void MultigridSolver::fullMultigrid()
+{
+    // Bring the right-hand side down to every level
+    for (size_t l = 0; l+1 < levels.size(); l++)
+    {
+        levels[l].r = levels[l].b;
+        restrictResidual(l);
+    }
+
+    // Solve on the coarsest level, then interpolate each solution up
+    // as the starting point of a V-cycle on the next finer level (a
+    // V-cycle only overwrites the right-hand sides of coarser levels)
+    int coarsest = levels.size()-1;
+    std::fill(levels[coarsest].x.begin(), levels[coarsest].x.end(), 0.0);
+    smooth(levels[coarsest], coarseSweeps);
+    for (int l = coarsest-1; l >= 0; l--)
+    {
+        std::fill(levels[l].xp, levels[l].xp + levels[l].r.size(), 0.0);
+        levels[l].r = levels[l].b;
+        prolongate(l);
+        vCycle(l);
+    }
+}
+
+
+void MultigridSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind)
+{
+    auto startOfSolveMethod = std::chrono::high_resolution_clock::now(); // Start recording execution time
+
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+    /////////////////////////////////////////////////////////////////
+    ////////      Divergence of the initial velocity field   ////////
+    /////////////////////////////////////////////////////////////////
+
+    R.resize( WGD->numcell_cent, 0.0 );
+    bool warm = initialGuess(WGD);
+    lambda_old.resize( WGD->numcell_cent, 0.0 );
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k < nz-2; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            for (int i = 0; i < nx-1; i++)
+            {
+                int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                int icell_face = i + j*nx + k*nx*ny;
+
+                /// Calculate divergence of initial velocity field
+                R[icell_cent] = (-2*pow(alpha1, 2.0))*((( WGD->u0[icell_face+1]     - WGD->u0[icell_face]) / WGD->dx ) +
+                                                       (( WGD->v0[icell_face + nx]    - WGD->v0[icell_face]) / WGD->dy ) +
+                                                       (( WGD->w0[icell_face + nx*ny] - WGD->w0[icell_face]) / WGD->dz_array[k] ));
+            }
+        }
+    }
+
+
+    if (solveWind)
+    {
+        auto startSolveSection = std::chrono::high_resolution_clock::now();
+
+        /////////////////////////////////////////////////
+        //           Multigrid solver              //////
+        /////////////////////////////////////////////////
+        loadCoefficients(WGD);
+
+        // The levels only depend on the geometry, so they are built on
+        // the first solve and kept while the coefficient arrays and the
+        // spans of fluid cells stay the same
+        if (levels.empty() || levels[0].e != coeff.e || levels[0].spans != spans ||
+            levels[0].b.size() != (size_t)WGD->numcell_cent)
+        {
+            buildLevels(WGD);
+        }
+        levels[0].xp = lambda.data();
+
+        // The SOR update is lambda = (sum of neighbors - R)/diag, so the
+        // right-hand side of the fine problem is -R
+        Level &fine = levels[0];
+        for (long id = 0; id < WGD->numcell_cent; id++)
+        {
+            fine.b[id] = -R[id];
+        }
+
+        std::cout << "Solving with " << levels.size() << " grid levels...\n";
+
+        int iter = 0;
+        float max_error = 1.0;
+        fineSweeps = 0;
+
+        while (iter < itermax && max_error > tol) {
+
+            // Save previous cycle values for error calculation
+            lambda_old.assign( lambda.begin(), lambda.end() );
+
+            // Full multigrid builds its own starting guess, so a warm
+            // start goes straight to V-cycles
+            if (iter == 0 && !warm)
+            {
+                fullMultigrid();
+            }
+            else
+            {
+                vCycle(0);
+            }
+
+            /// Mirror boundary condition (lambda (@k=0) = lambda (@k=1))
+            for (int j = 0; j < ny-1; j++){
+                for (int i = 0; i < nx-1; i++){
+                    int icell_cent = i + j*(nx-1);         /// Lineralized index for cell centered values
+                    lambda[icell_cent] = lambda[icell_cent + (nx-1)*(ny-1)];
+                }
+            }
+
+            /// Error calculation
+            max_error = 0.0;                   /// Reset error value before error calculation
+#pragma omp parallel for schedule(static) reduction(max:max_error)
+            for (long id = 0; id < WGD->numcell_cent; id++)
+            {
+                float error = fabs(lambda[id] - lambda_old[id]);
+                if (error > max_error)
+                {
+                    max_error = error;
+                }
+            }
+
+            iter += 1;
+        }
+        std::cout << "Solved!\n";
+        iterations = iter;
+
+        std::cout << "Number of cycles:" << iter << "\n";   // Print the number of multigrid cycles
+        std::cout << "Number of fine-grid sweeps:" << fineSweeps << "\n";
+        std::cout << "Error:" << max_error << "\n";
+        std::cout << "tol:" << tol << "\n";
+
+
+        ////////////////////////////////////////////////////////////////////////
+        /////   Update the velocity field using Euler-Lagrange equations   /////
+        ////////////////////////////////////////////////////////////////////////
+
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < nz-1; k++)
+        {
+            for (int j = 0; j < ny; j++)
+            {
+                for (int i = 0; i < nx; i++)
+                {
+                    int icell_face = i + j*nx + k*nx*ny;   /// Lineralized index for cell faced values
+                    WGD->u[icell_face] = WGD->u0[icell_face];
+                    WGD->v[icell_face] = WGD->v0[icell_face];
+                    WGD->w[icell_face] = WGD->w0[icell_face];
+                }
+            }
+        }
+
+        // /////////////////////////////////////////////
+        /// Update velocity field using Euler equations
+        // /////////////////////////////////////////////
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int k = 1; k < nz-2; k++)
+        {
+            for (int j = 1; j < ny-1; j++)
+            {
+                for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++)
+                {
+                    for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(nx-1, spans->spanEnd[s]); i++)
+                    {
+                        int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);   /// Lineralized index for cell centered values
+                        int icell_face = i + j*nx + k*nx*ny;               /// Lineralized index for cell faced values
+
+                        float c[6];
+                        WGD->getCoefficients(icell_cent, k, c);
+
+                        WGD->u[icell_face] = WGD->u0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[1]*WGD->dx*(lambda[icell_cent]-lambda[icell_cent-1]);
+
+                        WGD->v[icell_face] = WGD->v0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[3]*WGD->dy*(lambda[icell_cent]-lambda[icell_cent - (nx-1)]);
+
+                        WGD->w[icell_face] = WGD->w0[icell_face]+(1/(2*pow(alpha2, 2.0))) *
+                            c[5]*WGD->dz_array[k]*(lambda[icell_cent]-lambda[icell_cent - (nx-1)*(ny-1)]);
+                    }
+                }
+            }
+        }
+
+        zeroSolidVelocities(WGD);
+
+        auto finish = std::chrono::high_resolution_clock::now();  // Finish recording execution time
+        std::chrono::duration<float> elapsedTotal = finish - startOfSolveMethod;
+        std::chrono::duration<float> elapsedSolve = finish - startSolveSection;
+        std::cout << "Elapsed total time: " << elapsedTotal.count() << " s\n";   // Print out elapsed execution time
+        std::cout << "Elapsed solve time: " << elapsedSolve.count() << " s\n";   // Print out elapsed execution time
+    }
+}
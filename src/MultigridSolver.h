@@ -0,0 +1,149 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * This is child class of the solver that solves for the Lagrange
+ * multipliers with a geometric multigrid method on a CPU.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "WINDSInputData.h"
+#include "Solver.h"
+
+
+/**
+ * Geometric multigrid solver
+ *
+ * The cell-centered grid is coarsened by a factor of two in every
+ * direction that is still large enough.  The coarse operators are
+ * built from the fine ones by summing the face conductances
+ * (coefficient times cell volume) between fluid cells, so building
+ * and terrain cells (icellflag 0 or 2) drop out of the coarse problems
+ * and the stretched dz_array is carried down through the volumes.
+ *
+ * A full multigrid (FMG) pass provides the starting guess, then
+ * V-cycles with red-black Gauss-Seidel smoothing are repeated until the
+ * change of lambda over one cycle drops below the tolerance.
+ */
+class MultigridSolver : public Solver
+{
+public:
+    MultigridSolver(const WINDSInputData* WID, WINDSGeneralData* WGD);
+
+protected:
+
+    /*
+     * One level of the grid hierarchy.  All arrays use a padded layout
+     * with one ghost cell on each side, like the cell-centered arrays
+     * of WINDSGeneralData.  Ghost values are zero (Dirichlet).
+     */
+    struct Level
+    {
+        int lx, ly, lz;          /**< Number of interior cells */
+        int fx, fy, fz;          /**< Coarsening factor from the finer level */
+        long px, pxy;            /**< Strides of the padded layout */
+
+        const float *e, *f, *g, *h, *m, *n;   /**< Coefficients (fine level points into WGD) */
+        std::vector<float> ce, cf, cg, ch, cm, cn;   /**< Coefficients owned by coarse levels */
+        std::vector<float> x, b, r;           /**< Solution, right-hand side and residual */
+        std::vector<float> z;                 /**< Interpolated coarse correction */
+        float *xp;                            /**< Solution (fine level points to lambda) */
+        std::vector<float> scale;             /**< Cell volume per k-level used for restriction */
+        std::vector<unsigned char> active;    /**< Fluid cell flag */
+        const ActiveCells *spans = nullptr;   /**< Spans of fluid cells (fine level only) */
+
+        long index(int i, int j, int k) const
+        {
+            return i + j*px + k*pxy;
+        }
+    };
+
+    std::vector<Level> levels;
+
+    const int preSweeps = 2;        /**< Smoothing sweeps before restriction */
+    const int postSweeps = 2;       /**< Smoothing sweeps after prolongation */
+    const int coarseSweeps = 50;    /**< Smoothing sweeps on the coarsest level */
+
+    long fineSweeps;                /**< Number of sweeps done on the finest level */
+
+    /*
+     * Builds the level hierarchy from the coefficients and icellflag
+     * of the current geometry.  solve() reuses it until the geometry
+     * changes.
+     */
+    void buildLevels(WINDSGeneralData* WGD);
+
+    /*
+     * Red-black Gauss-Seidel sweeps on one level.
+     */
+    void smooth(Level &L, int sweeps);
+
+    /*
+     * Computes r = b - A x on one level.
+     */
+    void residual(Level &L);
+
+    /*
+     * Sums the residual of the fluid cells of level l into the
+     * right-hand side of level l+1.
+     */
+    void restrictResidual(int l);
+
+    /*
+     * Interpolates the solution of level l+1 and adds it, with the step
+     * length that minimizes the error energy, to the fluid cells of
+     * level l.  Uses the residual of level l.
+     */
+    void prolongate(int l);
+
+    /*
+     * Recursive V-cycle starting at level l.
+     */
+    void vCycle(int l);
+
+    /*
+     * Full multigrid pass used as initial guess.
+     */
+    void fullMultigrid();
+
+    virtual void solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind);
+};
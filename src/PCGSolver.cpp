@@ -0,0 +1,367 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "PCGSolver.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::cout;
+
+PCGSolver::PCGSolver(const WINDSInputData* WID, WINDSGeneralData* WGD)
+    : Solver(WID, WGD)
+{
+    preconditioner = WID->simParams->pcgPreconditioner;
+    if (preconditioner != Jacobi && preconditioner != SymmetricGS)
+    {
+        std::cerr << "[ERROR] invalid PCG preconditioner (1-Jacobi, 2-symmetric Gauss-Seidel)\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+void PCGSolver::applyOperator(WINDSGeneralData* WGD, const std::vector<float> &p, std::vector<float> &q)
+{
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const long stride_j = nx-1;                 /// Offset between j-neighbors
+    const long stride_k = (nx-1)*(ny-1);        /// Offset between k-neighbors
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k < nz-2; k++){
+        for (int j = 1; j < ny-2; j++){
+            for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++){
+                for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(nx-2, spans->spanEnd[s]); i++){
+                    long icell_cent = i + j*stride_j + k*stride_k;   /// Lineralized index for cell centered values
+                    q[icell_cent] = volume[k] *
+                        ( ( coeff.e[icell_cent] + coeff.f[icell_cent] + coeff.g[icell_cent] +
+                            coeff.h[icell_cent] + coeff.m[icell_cent] + coeff.n[icell_cent] ) * p[icell_cent] -
+                          ( coeff.e[icell_cent] * p[icell_cent+1]        + coeff.f[icell_cent] * p[icell_cent-1] +
+                            coeff.g[icell_cent] * p[icell_cent+stride_j] + coeff.h[icell_cent] * p[icell_cent-stride_j] +
+                            coeff.m[icell_cent] * p[icell_cent+stride_k] + coeff.n[icell_cent] * p[icell_cent-stride_k] ) );
+                }
+            }
+        }
+    }
+}
+
+
+void PCGSolver::applyPreconditioner(WINDSGeneralData* WGD)
+{
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const long stride_j = nx-1;                 /// Offset between j-neighbors
+    const long stride_k = (nx-1)*(ny-1);        /// Offset between k-neighbors
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+    if (preconditioner == Jacobi)
+    {
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int k = 1; k < nz-2; k++){
+            for (int j = 1; j < ny-2; j++){
+                for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++){
+                    for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(nx-2, spans->spanEnd[s]); i++){
+                        long icell_cent = i + j*stride_j + k*stride_k;
+                        float diag = coeff.e[icell_cent] + coeff.f[icell_cent] + coeff.g[icell_cent] +
+                                     coeff.h[icell_cent] + coeff.m[icell_cent] + coeff.n[icell_cent];
+                        if (diag > 0.0)
+                        {
+                            z[icell_cent] = r[icell_cent] / (volume[k]*diag);
+                        }
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+    // Symmetric Gauss-Seidel in red-black order, starting from zero.
+    // The forward pass is red then black and the backward pass black
+    // then red; the second black pass would not change anything, so
+    // only the red pass is repeated.
+    std::fill(z.begin(), z.end(), 0.0);
+    const int colors[3] = {0, 1, 0};
+    for (int c = 0; c < 3; c++)
+    {
+        int color = colors[c];
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int k = 1; k < nz-2; k++){
+            for (int j = 1; j < ny-2; j++){
+                for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++){
+                    // first i of the span that belongs to the current color
+                    int i_first = MAX_S(1, spans->spanStart[s]);
+                    int i_start = i_first + ((i_first + j + k + color) & 1);
+                    for (int i = i_start; i < MIN_S(nx-2, spans->spanEnd[s]); i += 2){
+                        long icell_cent = i + j*stride_j + k*stride_k;
+                        float diag = coeff.e[icell_cent] + coeff.f[icell_cent] + coeff.g[icell_cent] +
+                                     coeff.h[icell_cent] + coeff.m[icell_cent] + coeff.n[icell_cent];
+                        if (diag == 0.0)
+                        {
+                            continue;
+                        }
+                        z[icell_cent] = ( r[icell_cent] / volume[k] +
+                                          coeff.e[icell_cent] * z[icell_cent+1]        + coeff.f[icell_cent] * z[icell_cent-1] +
+                                          coeff.g[icell_cent] * z[icell_cent+stride_j] + coeff.h[icell_cent] * z[icell_cent-stride_j] +
+                                          coeff.m[icell_cent] * z[icell_cent+stride_k] + coeff.n[icell_cent] * z[icell_cent-stride_k] ) / diag;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void PCGSolver::solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind)
+{
+    auto startOfSolveMethod = std::chrono::high_resolution_clock::now(); // Start recording execution time
+
+    const int nx = WGD->nx;
+    const int ny = WGD->ny;
+    const int nz = WGD->nz;
+    const ActiveCells *spans = WGD->activeCells;     /// Spans of fluid cells on each row
+
+    /////////////////////////////////////////////////////////////////
+    ////////      Divergence of the initial velocity field   ////////
+    /////////////////////////////////////////////////////////////////
+
+    R.resize( WGD->numcell_cent, 0.0 );
+    bool warm = initialGuess(WGD);
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int k = 1; k < nz-2; k++)
+    {
+        for (int j = 0; j < ny-1; j++)
+        {
+            for (int i = 0; i < nx-1; i++)
+            {
+                int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                int icell_face = i + j*nx + k*nx*ny;
+
+                /// Calculate divergence of initial velocity field
+                R[icell_cent] = (-2*pow(alpha1, 2.0))*((( WGD->u0[icell_face+1]     - WGD->u0[icell_face]) / WGD->dx ) +
+                                                       (( WGD->v0[icell_face + nx]    - WGD->v0[icell_face]) / WGD->dy ) +
+                                                       (( WGD->w0[icell_face + nx*ny] - WGD->w0[icell_face]) / WGD->dz_array[k] ));
+            }
+        }
+    }
+
+
+    if (solveWind)
+    {
+        auto startSolveSection = std::chrono::high_resolution_clock::now();
+
+        /////////////////////////////////////////////////
+        //      Preconditioned conjugate gradient  //////
+        /////////////////////////////////////////////////
+        loadCoefficients(WGD);
+
+        r.assign( WGD->numcell_cent, 0.0 );
+        z.assign( WGD->numcell_cent, 0.0 );
+        p.assign( WGD->numcell_cent, 0.0 );
+        q.assign( WGD->numcell_cent, 0.0 );
+
+        volume.resize( nz-1 );
+        for (int k = 0; k < nz-1; k++)
+        {
+            volume[k] = WGD->dx*WGD->dy*WGD->dz_array[k];
+        }
+
+        active.resize( WGD->numcell_cent );
+        for (long id = 0; id < WGD->numcell_cent; id++)
+        {
+            active[id] = (WGD->icellflag[id] != 0 && WGD->icellflag[id] != 2);
+        }
+
+        // Starting from lambda = 0 the residual is the right-hand side
+        // of the SOR formulation (-R) times the cell volume; a warm start
+        // subtracts the operator applied to the initial guess
+        if (warm)
+        {
+            applyOperator(WGD, lambda, q);
+        }
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int k = 1; k < nz-2; k++){
+            for (int j = 1; j < ny-2; j++){
+                for (int i = 1; i < nx-2; i++){
+                    long icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                    if (active[icell_cent])
+                    {
+                        r[icell_cent] = -volume[k]*R[icell_cent] - q[icell_cent];
+                    }
+                }
+            }
+        }
+
+        applyPreconditioner(WGD);
+        p = z;
+
+        double rz = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:rz)
+        for (long id = 0; id < WGD->numcell_cent; id++)
+        {
+            rz += (double)r[id]*z[id];
+        }
+
+        int iter = 0;
+        float max_error = 1.0;
+
+        std::cout << "Solving...\n";
+        while (iter < itermax && max_error > tol) {
+
+            applyOperator(WGD, p, q);
+
+            double pq = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:pq)
+            for (long id = 0; id < WGD->numcell_cent; id++)
+            {
+                pq += (double)p[id]*q[id];
+            }
+            if (pq <= 0.0)
+            {
+                break;      // nothing left to solve for
+            }
+            float alpha = rz/pq;
+
+            // Update lambda and the residual; the change of lambda is
+            // used as convergence criterion like in the SOR solvers
+            max_error = 0.0;
+#pragma omp parallel for schedule(static) reduction(max:max_error)
+            for (long id = 0; id < WGD->numcell_cent; id++)
+            {
+                float change = alpha*p[id];
+                lambda[id] += change;
+                r[id] -= alpha*q[id];
+                if (fabs(change) > max_error)
+                {
+                    max_error = fabs(change);
+                }
+            }
+
+            applyPreconditioner(WGD);
+
+            double rz_new = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:rz_new)
+            for (long id = 0; id < WGD->numcell_cent; id++)
+            {
+                rz_new += (double)r[id]*z[id];
+            }
+            float beta = rz_new/rz;
+            rz = rz_new;
+
+#pragma omp parallel for schedule(static)
+            for (long id = 0; id < WGD->numcell_cent; id++)
+            {
+                p[id] = z[id] + beta*p[id];
+            }
+
+            iter += 1;
+        }
+
+        /// Mirror boundary condition (lambda (@k=0) = lambda (@k=1))
+        for (int j = 0; j < ny-1; j++){
+            for (int i = 0; i < nx-1; i++){
+                int icell_cent = i + j*(nx-1);         /// Lineralized index for cell centered values
+                lambda[icell_cent] = lambda[icell_cent + (nx-1)*(ny-1)];
+            }
+        }
+
+        std::cout << "Solved!\n";
+        iterations = iter;
+
+        std::cout << "Number of iterations:" << iter << "\n";   // Print the number of iterations
+        std::cout << "Error:" << max_error << "\n";
+        std::cout << "tol:" << tol << "\n";
+
+
+        ////////////////////////////////////////////////////////////////////////
+        /////   Update the velocity field using Euler-Lagrange equations   /////
+        ////////////////////////////////////////////////////////////////////////
+
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < nz-1; k++)
+        {
+            for (int j = 0; j < ny; j++)
+            {
+                for (int i = 0; i < nx; i++)
+                {
+                    int icell_face = i + j*nx + k*nx*ny;   /// Lineralized index for cell faced values
+                    WGD->u[icell_face] = WGD->u0[icell_face];
+                    WGD->v[icell_face] = WGD->v0[icell_face];
+                    WGD->w[icell_face] = WGD->w0[icell_face];
+                }
+            }
+        }
+
+        // /////////////////////////////////////////////
+        /// Update velocity field using Euler equations
+        // /////////////////////////////////////////////
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int k = 1; k < nz-2; k++)
+        {
+            for (int j = 1; j < ny-1; j++)
+            {
+                for (int s = spans->rowBegin(j,k); s < spans->rowEnd(j,k); s++)
+                {
+                    for (int i = MAX_S(1, spans->spanStart[s]); i < MIN_S(nx-1, spans->spanEnd[s]); i++)
+                    {
+                        int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);   /// Lineralized index for cell centered values
+                        int icell_face = i + j*nx + k*nx*ny;               /// Lineralized index for cell faced values
+
+                        float c[6];
+                        WGD->getCoefficients(icell_cent, k, c);
+
+                        WGD->u[icell_face] = WGD->u0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[1]*WGD->dx*(lambda[icell_cent]-lambda[icell_cent-1]);
+
+                        WGD->v[icell_face] = WGD->v0[icell_face] + (1/(2*pow(alpha1, 2.0))) *
+                            c[3]*WGD->dy*(lambda[icell_cent]-lambda[icell_cent - (nx-1)]);
+
+                        WGD->w[icell_face] = WGD->w0[icell_face]+(1/(2*pow(alpha2, 2.0))) *
+                            c[5]*WGD->dz_array[k]*(lambda[icell_cent]-lambda[icell_cent - (nx-1)*(ny-1)]);
+                    }
+                }
+            }
+        }
+
+        zeroSolidVelocities(WGD);
+
+        auto finish = std::chrono::high_resolution_clock::now();  // Finish recording execution time
+        std::chrono::duration<float> elapsedTotal = finish - startOfSolveMethod;
+        std::chrono::duration<float> elapsedSolve = finish - startSolveSection;
+        std::cout << "Elapsed total time: " << elapsedTotal.count() << " s\n";   // Print out elapsed execution time
+        std::cout << "Elapsed solve time: " << elapsedSolve.count() << " s\n";   // Print out elapsed execution time
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * This is child class of the solver that solves for the Lagrange
+ * multipliers with a matrix-free preconditioned conjugate gradient
+ * method on a CPU.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "WINDSInputData.h"
+#include "Solver.h"
+
+
+/**
+ * Preconditioned conjugate gradient solver
+ *
+ * The 7-point stencil is applied straight from the e,f,g,h,m,n arrays
+ * of WINDSGeneralData, no matrix is assembled.  Multiplied by the cell
+ * volume the stencil is symmetric on the fluid cells, so CG is run on
+ * that scaled system.  Building and terrain cells are left out.
+ *
+ * The preconditioner is chosen with pcgPreconditioner in the
+ * simulation parameters: 1 for Jacobi, 2 for symmetric (red-black)
+ * Gauss-Seidel.
+ */
+class PCGSolver : public Solver
+{
+public:
+    PCGSolver(const WINDSInputData* WID, WINDSGeneralData* WGD);
+
+protected:
+
+    enum PreconditionerType : int {Jacobi = 1, SymmetricGS = 2};
+
+    int preconditioner;             /**< Preconditioner type */
+
+    std::vector<float> r, z, p, q;  /**< Residual, preconditioned residual, search direction and A*p */
+    std::vector<float> volume;      /**< Cell volume per k-level */
+    std::vector<unsigned char> active;   /**< Fluid cell flag */
+
+    /*
+     * Computes q = A p for the volume-scaled system.
+     */
+    void applyOperator(WINDSGeneralData* WGD, const std::vector<float> &p, std::vector<float> &q);
+
+    /*
+     * Computes z = M^-1 r with the selected preconditioner.
+     */
+    void applyPreconditioner(WINDSGeneralData* WGD);
+
+    virtual void solve(const WINDSInputData* WID, WINDSGeneralData* WGD, bool solveWind);
+};
@@ -0,0 +1,210 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "ParameterizationCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "WINDSInputData.h"
+#include "WINDSGeneralData.h"
+
+
+ParameterizationCache::ParameterizationCache(float dirTolerance, float speedTolerance)
+    : m_dirTolerance( dirTolerance*M_PI/180.0 ),
+      m_speedTolerance( speedTolerance )
+{
+}
+
+
+void ParameterizationCache::startStep()
+{
+    replayed = 0;
+    recomputed = 0;
+    savedTime = 0.0;
+}
+
+
+bool ParameterizationCache::prepare(Building::Parameterization p, int id, float u_h, float v_h, Building::CellBox &box)
+{
+    std::vector<Zone> &zones = m_zones[p];
+    if (zones.size() <= (size_t)id)
+    {
+        zones.resize(id+1);
+    }
+
+    Zone &zone = zones[id];
+    zone.u_h = u_h;
+    zone.v_h = v_h;
+    zone.cellBox = box;
+    zone.replay = false;
+    if (zone.valid)
+    {
+        float speed = sqrt(u_h*u_h + v_h*v_h);
+        float turn = std::abs(remainder(atan2(v_h, u_h) - zone.dir, 2.0*M_PI));
+        zone.replay = (turn <= m_dirTolerance && std::abs(speed - zone.speed) <= m_speedTolerance*zone.speed);
+    }
+
+    if (zone.replay && !zone.box.empty())
+    {
+        box.add(zone.box.i_min, zone.box.i_max, zone.box.j_min, zone.box.j_max, zone.box.k_min, zone.box.k_max);
+    }
+    return zone.replay;
+}
+
+
+void ParameterizationCache::apply(Building::Parameterization p, int id, const WINDSInputData *WID, WINDSGeneralData *WGD)
+{
+    Zone &zone = m_zones[p][id];
+    float speed = sqrt(zone.u_h*zone.u_h + zone.v_h*zone.v_h);
+
+    if (zone.replay)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t n = 0; n < zone.faces.size(); n++)
+        {
+            WGD->u0[zone.faces[n]] = zone.u[n]*speed;
+            WGD->v0[zone.faces[n]] = zone.v[n]*speed;
+            WGD->w0[zone.faces[n]] = zone.w[n]*speed;
+        }
+        for (size_t n = 0; n < zone.cells.size(); n++)
+        {
+            WGD->icellflag[zone.cells[n]] = zone.flags[n];
+        }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+#pragma omp atomic
+        replayed++;
+#pragma omp atomic
+        savedTime += zone.time - elapsed.count();
+#pragma omp atomic
+        totalSavedTime += zone.time - elapsed.count();
+        return;
+    }
+
+    const Building::CellBox &box = zone.cellBox;
+    int nx = WGD->nx, ny = WGD->ny, nz = WGD->nz;
+    int i_min = std::max(box.i_min, 0), i_max = std::min(box.i_max, nx-1);
+    int j_min = std::max(box.j_min, 0), j_max = std::min(box.j_max, ny-1);
+    int k_min = std::max(box.k_min, 0), k_max = std::min(box.k_max, nz-1);
+    int i_maxCell = std::min(i_max, nx-2);
+    if (i_min > i_max || j_min > j_max)
+    {
+        k_max = k_min-1;
+    }
+
+    // Velocities and flags of the rows of the box before the
+    // parameterization
+    std::vector<float> u, v, w;
+    std::vector<int> flags;
+    size_t size = (k_max >= k_min) ? (size_t)(k_max-k_min+1)*(j_max-j_min+1)*(i_max-i_min+1) : 0;
+    u.reserve(size);
+    v.reserve(size);
+    w.reserve(size);
+    flags.reserve(size);
+    for (int k = k_min; k <= k_max; k++)
+    {
+        for (int j = j_min; j <= j_max; j++)
+        {
+            long icell_face = i_min + j*nx + (long)k*nx*ny;
+            u.insert(u.end(), &WGD->u0[icell_face], &WGD->u0[icell_face] + i_max-i_min+1);
+            v.insert(v.end(), &WGD->v0[icell_face], &WGD->v0[icell_face] + i_max-i_min+1);
+            w.insert(w.end(), &WGD->w0[icell_face], &WGD->w0[icell_face] + i_max-i_min+1);
+            if (j < ny-1 && k < nz-1 && i_min <= i_maxCell)
+            {
+                long icell_cent = i_min + j*(nx-1) + (long)k*(nx-1)*(ny-1);
+                flags.insert(flags.end(), &WGD->icellflag[icell_cent], &WGD->icellflag[icell_cent] + i_maxCell-i_min+1);
+            }
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    WGD->allBuildingsV[id]->applyParameterization(p, WID, WGD, id);
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+#pragma omp atomic
+    recomputed++;
+
+    // The zone is the cells that changed
+    zone.valid = (speed > 0.0);
+    zone.dir = atan2(zone.v_h, zone.u_h);
+    zone.speed = speed;
+    zone.time = elapsed.count();
+    zone.box = Building::CellBox();
+    if (k_min <= k_max)
+    {
+        zone.box.add(i_min, i_max, j_min, j_max, k_min, k_max);
+    }
+    zone.faces.clear();
+    zone.u.clear();
+    zone.v.clear();
+    zone.w.clear();
+    zone.cells.clear();
+    zone.flags.clear();
+    if (!zone.valid)
+    {
+        return;
+    }
+
+    size_t n = 0, c = 0;
+    for (int k = k_min; k <= k_max; k++)
+    {
+        for (int j = j_min; j <= j_max; j++)
+        {
+            long icell_face = i_min + j*nx + (long)k*nx*ny;
+            for (int i = 0; i <= i_max-i_min; i++, n++)
+            {
+                if (WGD->u0[icell_face+i] != u[n] || WGD->v0[icell_face+i] != v[n] || WGD->w0[icell_face+i] != w[n])
+                {
+                    zone.faces.push_back(icell_face+i);
+                    zone.u.push_back(WGD->u0[icell_face+i]/speed);
+                    zone.v.push_back(WGD->v0[icell_face+i]/speed);
+                    zone.w.push_back(WGD->w0[icell_face+i]/speed);
+                }
+            }
+            if (j < ny-1 && k < nz-1 && i_min <= i_maxCell)
+            {
+                long icell_cent = i_min + j*(nx-1) + (long)k*(nx-1)*(ny-1);
+                for (int i = 0; i <= i_maxCell-i_min; i++, c++)
+                {
+                    if (WGD->icellflag[icell_cent+i] != flags[c])
+                    {
+                        zone.cells.push_back(icell_cent+i);
+                        zone.flags.push_back(WGD->icellflag[icell_cent+i]);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * Cache of the zones of the building parameterizations, kept from one
+ * time step to the next.
+ *
+ * The zone of a building for a parameterization is made of the cells
+ * that the parameterization changed: their velocities, divided by the
+ * wind speed at the centroid of the roof, and their flags. At the next
+ * time steps, while the wind direction at the roof stays within
+ * dirTolerance of the one the zone was computed with and the speed
+ * within speedTolerance of its speed, the zone is replayed (velocities
+ * scaled by the new speed) instead of applying the parameterization.
+ */
+
+#include <vector>
+
+#include "Building.h"
+
+class ParameterizationCache
+{
+public:
+
+    /*
+     * @param dirTolerance -change of the wind direction at the roof (degrees)
+     * @param speedTolerance -relative change of the wind speed at the roof
+     */
+    ParameterizationCache(float dirTolerance, float speedTolerance);
+
+    /*
+     * Resets the counters of the time step.
+     */
+    void startStep();
+
+    /*
+     * Sets the wind at the roof centroid of a building before
+     * parameterization p, and decides whether its zone is replayed.
+     *
+     * @param box -the cells of the parameterization, extended to the
+     *             zone if it is replayed
+     * @return true if the zone is replayed
+     */
+    bool prepare(Building::Parameterization p, int id, float u_h, float v_h, Building::CellBox &box);
+
+    /*
+     * Replays the zone of a building, or applies parameterization p to
+     * it and keeps the cells of the box given to prepare that it
+     * changes (within the domain) as its zone.
+     */
+    void apply(Building::Parameterization p, int id, const WINDSInputData *WID, WINDSGeneralData *WGD);
+
+    int replayed = 0;           /**< Zones replayed during the time step */
+    int recomputed = 0;         /**< Parameterizations applied during the time step */
+    double savedTime = 0.0;     /**< Time of the parameterizations replayed (s), less the time of the replays */
+    double totalSavedTime = 0.0;
+
+private:
+
+    struct Zone
+    {
+        bool valid = false;
+        bool replay = false;
+        float dir, speed;               // Wind at the roof when the zone was computed
+        float u_h, v_h;                 // Wind at the roof at this time step
+        Building::CellBox cellBox;      // Cells of the parameterization at this time step
+        double time = 0.0;              // Time to apply the parameterization (s)
+        Building::CellBox box;          // Box of the zone
+        std::vector<long> faces;        // Faces whose velocity changed
+        std::vector<float> u, v, w;     // Their velocities, divided by the speed
+        std::vector<long> cells;        // Cells whose flag changed
+        std::vector<int> flags;
+    };
+
+    static const int numParameterizations = 5;
+
+    float m_dirTolerance, m_speedTolerance;
+    std::vector<Zone> m_zones[numParameterizations];
+};
@@ -37,6 +37,33 @@
 #include "WINDSInputData.h"
 #include "WINDSGeneralData.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/*
+ * Sets a building flag to a building number if it is higher. The
+ * buildings flag their cells in increasing order of their numbers, so
+ * a cell shared by several buildings gets the number of the last one
+ * whether or not the buildings are flagged in parallel (shared).
+ */
+static inline void setBuildingFlag(int &flag, int building_number, bool shared)
+{
+  if (shared)
+  {
+    int current = __atomic_load_n(&flag, __ATOMIC_RELAXED);
+    while (current < building_number &&
+           !__atomic_compare_exchange_n(&flag, &current, building_number, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+  }
+  else
+  {
+    flag = std::max(flag, building_number);
+  }
+}
+
 
 PolyBuilding::PolyBuilding(const WINDSInputData* WID, WINDSGeneralData* WGD, int id)
               : Building()
@@ -116,6 +143,7 @@ void PolyBuilding::setPolyBuilding(WINDSGeneralData* WGD)
 *
 * This function defines bounds of the polygon building and sets the icellflag values
 * for building cells. It applies the Stair-step method to define building bounds.
+* Different buildings can set their cells at the same time.
 *
 */
 void PolyBuilding::setCellFlags(const WINDSInputData* WID, WINDSGeneralData* WGD, int building_number)
@@ -185,39 +213,109 @@ void PolyBuilding::setCellFlags(const WINDSInputData* WID, WINDSGeneralData* WGD
     }
   }
 
+  // The cells of the building are restored with the geometry cache
+  if (WGD->geometryFromCache)
+  {
+    return;
+  }
+
   // Find out which cells are going to be inside the polygone
   // Based on Wm. Randolph Franklin, "PNPOLY - Point Inclusion in Polygon Test"
-  // Check the center of each cell, if it's inside, set that cell to building
+  // The center of a cell is inside if an odd number of edges cross the
+  // ray from it in the +x direction. The crossings of each row of cell
+  // centers are computed once, from a table of the edges sorted by
+  // their first row, and the cells are set span by span.
+
+  // Edges of the rings of the polygon (the last vertex of a ring is
+  // its first one), with the first and last rows they may cross
+  struct PolyEdge
+  {
+    int vert, row_first, row_last;
+  };
+  std::vector<PolyEdge> edges;
+  vert_id = 0;               // Node index
+  start_poly = vert_id;
+  while (vert_id < polygonVertices.size()-1)
+  {
+    float y_low = std::min(polygonVertices[vert_id].y_poly, polygonVertices[vert_id+1].y_poly);
+    float y_high = std::max(polygonVertices[vert_id].y_poly, polygonVertices[vert_id+1].y_poly);
+    if (y_low < y_high)
+    {
+      int row_first = std::max(j_start, (int)floor(y_low/WGD->dy-0.5)-1);
+      int row_last = std::min(j_end, (int)ceil(y_high/WGD->dy-0.5)+1);
+      if (row_first <= row_last)
+      {
+        edges.push_back({vert_id, row_first, row_last});
+      }
+    }
+    vert_id += 1;
+    if (polygonVertices[vert_id].x_poly == polygonVertices[start_poly].x_poly &&
+        polygonVertices[vert_id].y_poly == polygonVertices[start_poly].y_poly)
+    {
+      vert_id += 1;
+      start_poly = vert_id;
+    }
+  }
+  std::sort(edges.begin(), edges.end(),
+            [](const PolyEdge &a, const PolyEdge &b) { return a.row_first < b.row_first; });
+
+  // Other threads may be flagging other buildings
+  bool shared = false;
+#ifdef _OPENMP
+  shared = omp_get_num_threads() > 1;
+#endif
+
+  std::vector<PolyEdge> active;
+  std::vector<float> crossings;
+  size_t next_edge = 0;
   for (auto j=j_start; j<=j_end; j++)
   {
     y_cent = (j+0.5)*WGD->dy;         // Center of cell y coordinate
+
+    // Update the edges that may cross the row
+    while (next_edge < edges.size() && edges[next_edge].row_first <= j)
+    {
+      active.push_back(edges[next_edge++]);
+    }
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [j](const PolyEdge &e) { return e.row_last < j; }), active.end());
+
+    crossings.clear();
+    for (auto e = 0; e < active.size(); e++)
+    {
+      vert_id = active[e].vert;
+      if ( (polygonVertices[vert_id].y_poly<=y_cent && polygonVertices[vert_id+1].y_poly>y_cent) ||
+           (polygonVertices[vert_id].y_poly>y_cent && polygonVertices[vert_id+1].y_poly<=y_cent) )
+      {
+        ray_intersect = (y_cent-polygonVertices[vert_id].y_poly)/(polygonVertices[vert_id+1].y_poly-polygonVertices[vert_id].y_poly);
+        crossings.push_back(polygonVertices[vert_id].x_poly+ray_intersect*(polygonVertices[vert_id+1].x_poly-polygonVertices[vert_id].x_poly));
+      }
+    }
+    if (crossings.empty())
+    {
+      continue;
+    }
+    std::sort(crossings.begin(), crossings.end());
+
+    // num_crossing is the number of crossings to the right of the
+    // center of the cell: it changes at each crossing, the cells
+    // between two crossings form a span
+    size_t left = 0;
     for (auto i=i_start; i<=i_end; i++)
     {
       x_cent = (i+0.5)*WGD->dx;       // Center of cell x coordinate
-      vert_id = 0;               // Node index
-      start_poly = vert_id;
-      num_crossing = 0;
-      while (vert_id < polygonVertices.size()-1)
+      while (left < crossings.size() && !(x_cent < crossings[left]))
       {
-        if ( (polygonVertices[vert_id].y_poly<=y_cent && polygonVertices[vert_id+1].y_poly>y_cent) ||
-             (polygonVertices[vert_id].y_poly>y_cent && polygonVertices[vert_id+1].y_poly<=y_cent) )
-        {
-          ray_intersect = (y_cent-polygonVertices[vert_id].y_poly)/(polygonVertices[vert_id+1].y_poly-polygonVertices[vert_id].y_poly);
-          if (x_cent < (polygonVertices[vert_id].x_poly+ray_intersect*(polygonVertices[vert_id+1].x_poly-polygonVertices[vert_id].x_poly)))
-          {
-            num_crossing += 1;
-          }
-        }
-        vert_id += 1;
-        if (polygonVertices[vert_id].x_poly == polygonVertices[start_poly].x_poly &&
-            polygonVertices[vert_id].y_poly == polygonVertices[start_poly].y_poly)
-        {
-          vert_id += 1;
-          start_poly = vert_id;
-        }
+        left++;
+      }
+      if (left == crossings.size())
+      {
+        break;
       }
-      // if num_crossing is odd = cell is oustside of the polygon
-      // if num_crossing is even = cell is inside of the polygon
+      num_crossing = crossings.size() - left;
+
+      // if num_crossing is odd = cell is inside of the polygon
+      // if num_crossing is even = cell is oustside of the polygon
       if ( (num_crossing%2) != 0 )
       {
         for (auto k=k_start; k<k_end; k++)
@@ -225,13 +323,59 @@ void PolyBuilding::setCellFlags(const WINDSInputData* WID, WINDSGeneralData* WGD
           int icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);
           if (WID->simParams->readCoefficientsFlag == 0)
           {
+#pragma omp atomic write
             WGD->icellflag[icell_cent] = 0;
           }
-          WGD->ibuilding_flag[icell_cent] = building_number;
+          setBuildingFlag(WGD->ibuilding_flag[icell_cent], building_number, shared);
         }
-
       }
-
     }
   }
 }
+
+
+void PolyBuilding::prepareParameterization (Parameterization p, const WINDSInputData* WID, WINDSGeneralData* WGD, CellBox &box)
+{
+  switch (p)
+  {
+  case UpwindCavity:
+    upwindCavityCells(WGD, box);
+    break;
+  case Wake:
+    prepareWake(WID, WGD);
+    wakeCells(WGD, box);
+    break;
+  case StreetCanyon:
+    streetCanyonCells(WGD, box);
+    break;
+  case Sidewall:
+    sideWallCells(WGD, box);
+    break;
+  case Rooftop:
+    rooftopCells(WGD, box);
+    break;
+  }
+}
+
+
+void PolyBuilding::applyParameterization (Parameterization p, const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id)
+{
+  switch (p)
+  {
+  case UpwindCavity:
+    upwindCavity(WID, WGD);
+    break;
+  case Wake:
+    applyWake(WID, WGD, building_id);
+    break;
+  case StreetCanyon:
+    streetCanyon(WGD);
+    break;
+  case Sidewall:
+    sideWall(WID, WGD);
+    break;
+  case Rooftop:
+    rooftop(WID, WGD);
+    break;
+  }
+}
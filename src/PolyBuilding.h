@@ -76,6 +76,10 @@ protected:
     int icell_cent, icell_face;
     float x1, x2, y1, y2;
     std::vector<float> upwind_rel_dir;
+    std::vector<float> Lr_node;            // Length of the wake behind each node (see prepareWake)
+    int wake_stop_id;                      // Last face of the wake
+    int wake_k_bottom, wake_k_top;         // Layers of the wake
+    int wake_kk;                           // Layer where the wake looks for downwind buildings
 
 
 public:
@@ -142,6 +146,16 @@ public:
     */
     void polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id);
 
+    /**
+    *
+    * These functions are the two parts of polygonWake: prepareWake finds the wind direction, the
+    * effective dimensions of the building and the length of the wake behind its nodes, and applyWake
+    * applies the parameterization to the cells of the wake.
+    *
+    */
+    void prepareWake (const WINDSInputData* WID, WINDSGeneralData* WGD);
+    void applyWake (const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id);
+
 
     /**
     *
@@ -179,4 +193,29 @@ public:
     */
     void rooftop (const WINDSInputData* WID, WINDSGeneralData* WGD);
 
+
+    bool roofCentroid (int &i, int &j, int &k) const
+    {
+      i = i_building_cent;
+      j = j_building_cent;
+      k = k_end;
+      return true;
+    }
+
+    /**
+    *
+    * These functions give the cells and faces that the parameterizations may read or write (see
+    * Building::prepareParameterization), from the loops of the parameterizations: the bounds of the
+    * rooftop do not depend on the wind direction, the ones of the other parameterizations (the wake
+    * once prepared) are found from the wind at the roof centroid.
+    *
+    */
+    void prepareParameterization (Parameterization p, const WINDSInputData* WID, WINDSGeneralData* WGD, CellBox &box);
+    void applyParameterization (Parameterization p, const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id);
+    void upwindCavityCells (const WINDSGeneralData* WGD, CellBox &box) const;
+    void wakeCells (const WINDSGeneralData* WGD, CellBox &box) const;
+    void streetCanyonCells (const WINDSGeneralData* WGD, CellBox &box) const;
+    void sideWallCells (const WINDSGeneralData* WGD, CellBox &box) const;
+    void rooftopCells (const WINDSGeneralData* WGD, CellBox &box) const;
+
 };
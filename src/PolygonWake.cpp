@@ -38,6 +38,9 @@
 #include "WINDSGeneralData.h"
 
 
+// Length of the far wake, in lengths of the cavity
+static const float farwake_factor = 3;
+
 
 /**
 *
@@ -50,42 +53,30 @@
 */
 void PolyBuilding::polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id)
 {
+  prepareWake(WID, WGD);
+  applyWake(WID, WGD, building_id);
+}
 
-  std::vector<float> Lr_face, Lr_node;
-  std::vector<int> perpendicular_flag;
+
+/**
+*
+* This function finds the wind direction at the building, its effective dimensions and the length
+* of the wake behind each node, for applyWake.
+*
+*/
+void PolyBuilding::prepareWake (const WINDSInputData* WID, WINDSGeneralData* WGD)
+{
+  std::vector<float> Lr_face;
   Lr_face.resize (polygonVertices.size(), -1.0);       // Length of wake for each face
-  Lr_node.resize (polygonVertices.size(), 0.0);       // Length of wake for each node
-  perpendicular_flag.resize (polygonVertices.size(), 0);
+  Lr_node.assign (polygonVertices.size(), 0.0);       // Length of wake for each node
   upwind_rel_dir.resize (polygonVertices.size(), 0.0);      // Upwind reletive direction for each face
-  float z_build;                  // z value of each building point from its base height
-  float yc, xc;
-  float Lr_local, Lr_local_u, Lr_local_v, Lr_local_w;   // Local length of the wake for each velocity component
-  float x_wall, x_wall_u, x_wall_v, x_wall_w;
-  float y_norm, canyon_factor;
-  int x_id_min;
 
   float Lr_ave;                         // Average length of Lr
   float total_seg_length;               // Length of each edge
   int index_previous, index_next;       // Indices of previous and next nodes
-  int stop_id = 0;
-  int kk;
   float tol;
-  float farwake_exp = 1.5;
-  float farwake_factor = 3;
-  float epsilon = 10e-10;
-  int u_wake_flag, v_wake_flag, w_wake_flag;
-  int i_u, j_u, i_v, j_v, i_w, j_w;          // i and j indices for x, y and z directions
-  float xp, yp;
-  float xu, yu, xv, yv, xw, yw;
-  float dn_u, dn_v, dn_w;             // Length of cavity zone
-  float farwake_vel;
-  std::vector<double> u_temp, v_temp;
-  u_temp.resize (WGD->nx*WGD->ny, 0.0);
-  v_temp.resize (WGD->nx*WGD->ny, 0.0);
-  std::vector<double> u0_modified, v0_modified;
-  std::vector<int> u0_mod_id, v0_mod_id;
   float R_scale, R_cx, vd, hd, shell_height;
-  int k_bottom, k_top;
+  wake_stop_id = 0;
 
   int index_building_face = i_building_cent + j_building_cent*WGD->nx + (k_end)*WGD->nx*WGD->ny;
   u0_h = WGD->u0[index_building_face];         // u velocity at the height of building at the centroid
@@ -239,7 +230,7 @@ void PolyBuilding::polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD
     if ((polygonVertices[id+1].x_poly > polygonVertices[0].x_poly-0.1) && (polygonVertices[id+1].x_poly < polygonVertices[0].x_poly+0.1)
          && (polygonVertices[id+1].y_poly > polygonVertices[0].y_poly-0.1) && (polygonVertices[id+1].y_poly < polygonVertices[0].y_poly+0.1))
     {
-      stop_id = id;
+      wake_stop_id = id;
       break;
     }
   }
@@ -247,7 +238,7 @@ void PolyBuilding::polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD
   Lr = Lr_ave/total_seg_length;
   for (auto k = 1; k <= k_start; k++)
   {
-    k_bottom = k;
+    wake_k_bottom = k;
     if (base_height <= WGD->z[k])
     {
       break;
@@ -256,7 +247,7 @@ void PolyBuilding::polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD
 
   for (auto k = k_start; k < WGD->nz-2; k++)
   {
-    k_top = k;
+    wake_k_top = k;
     if (height_eff < WGD->z[k+1])
     {
       break;
@@ -265,13 +256,51 @@ void PolyBuilding::polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD
 
   for (auto k = k_start; k < k_end; k++)
   {
-    kk = k;
+    wake_kk = k;
     if (0.75*H+base_height <= WGD->z[k])
     {
       break;
     }
   }
 
+}
+
+
+/**
+*
+* This function applies the wake parameterization prepared by prepareWake.
+*
+*/
+void PolyBuilding::applyWake (const WINDSInputData* WID, WINDSGeneralData* WGD, int building_id)
+{
+  std::vector<int> perpendicular_flag;
+  perpendicular_flag.resize (polygonVertices.size(), 0);
+  float z_build;                  // z value of each building point from its base height
+  float yc, xc;
+  float Lr_local, Lr_local_u, Lr_local_v, Lr_local_w;   // Local length of the wake for each velocity component
+  float x_wall, x_wall_u, x_wall_v, x_wall_w;
+  float y_norm, canyon_factor;
+  int x_id_min;
+
+  int stop_id = wake_stop_id;
+  int kk = wake_kk;
+  float tol = 0.01*M_PI/180.0;
+  float farwake_exp = 1.5;
+  float epsilon = 10e-10;
+  int u_wake_flag, v_wake_flag, w_wake_flag;
+  int i_u, j_u, i_v, j_v, i_w, j_w;          // i and j indices for x, y and z directions
+  float xp, yp;
+  float xu, yu, xv, yv, xw, yw;
+  float dn_u, dn_v, dn_w;             // Length of cavity zone
+  float farwake_vel;
+  std::vector<double> u_temp, v_temp;
+  u_temp.resize (WGD->nx*WGD->ny, 0.0);
+  v_temp.resize (WGD->nx*WGD->ny, 0.0);
+  std::vector<double> u0_modified, v0_modified;
+  std::vector<int> u0_mod_id, v0_mod_id;
+  int k_bottom = wake_k_bottom, k_top = wake_k_top;
+
+
   for (auto k=k_top; k>=k_bottom; k--)
   {
     z_build = WGD->z[k] - base_height;
@@ -573,3 +602,53 @@ void PolyBuilding::polygonWake (const WINDSInputData* WID, WINDSGeneralData* WGD
   u0_modified.clear();
   v0_modified.clear();
 }
+
+
+/**
+*
+* This function gives the cells that applyWake may read or write: the cells along the lines followed
+* from each eligible face, up to the end of the far wake, in the layers of the wake.
+*
+*/
+void PolyBuilding::wakeCells (const WINDSGeneralData* WGD, CellBox &box) const
+{
+  float tol = 0.01*M_PI/180.0;
+  float yc, x_wall, Lr_local, x_end;
+  int k_min = MIN_S(wake_k_bottom, wake_kk);
+  int k_max = MAX_S(wake_k_top, wake_kk);
+
+  if (wake_k_top < wake_k_bottom)
+  {
+    return;
+  }
+
+  for (auto id=0; id<=wake_stop_id; id++)
+  {
+    if (abs(upwind_rel_dir[id]) < 0.5*M_PI)
+    {
+      for (auto y_id=0; y_id <= 2*ceil(abs(yi[id]-yi[id+1])/WGD->dxy); y_id++)
+      {
+        yc = yi[id]-0.5*y_id*WGD->dxy;
+        Lr_local = Lr_node[id]+(yc-yi[id])*(Lr_node[id+1]-Lr_node[id])/(yi[id+1]-yi[id]);
+        if (abs(upwind_rel_dir[id]) < tol)
+        {
+          x_wall = xi[id];
+        }
+        else
+        {
+          x_wall = ((xi[id+1]-xi[id])/(yi[id+1]-yi[id]))*(yc-yi[id])+xi[id];
+        }
+        // Last point of the far wake (the cavity search stops before)
+        x_end = ceil(farwake_factor*Lr_local/WGD->dxy)*WGD->dxy;
+        if (!(x_end > 0.0))
+        {
+          continue;
+        }
+        box.addPoint((0.5*WGD->dxy+x_wall)*cos(upwind_dir)-yc*sin(upwind_dir)+building_cent_x,
+                     (0.5*WGD->dxy+x_wall)*sin(upwind_dir)+yc*cos(upwind_dir)+building_cent_y, WGD->dx, WGD->dy, k_min, k_max);
+        box.addPoint((x_end+x_wall)*cos(upwind_dir)-yc*sin(upwind_dir)+building_cent_x,
+                     (x_end+x_wall)*sin(upwind_dir)+yc*cos(upwind_dir)+building_cent_y, WGD->dx, WGD->dy, k_min, k_max);
+      }
+    }
+  }
+}
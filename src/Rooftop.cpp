@@ -704,3 +704,16 @@ void PolyBuilding::rooftop (const WINDSInputData* WID, WINDSGeneralData* WGD)
   }
 
 }
+
+
+/**
+*
+* This function gives the cells that the rooftop may read or write: the columns of the building (and
+* the ones before it) above its roof, and the velocity at the roof centroid.
+*
+*/
+void PolyBuilding::rooftopCells (const WINDSGeneralData* WGD, CellBox &box) const
+{
+  box.add(i_start-1, i_end-1, j_start-1, j_end-1, k_end-1, WGD->nz-1);
+  box.add(i_building_cent, i_building_cent, j_building_cent, j_building_cent, k_end-1, WGD->nz-1);
+}
@@ -0,0 +1,209 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "SORKernels.h"
+
+#include <cmath>
+
+// The SIMD kernels are compiled with per-function target attributes,
+// so the rest of the code does not need to be built for AVX
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QES_SOR_X86 1
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Scalar update of cells [first, row.count) of a row.
+ */
+static inline float sorRowScalar(const SORRow &row, float omega, int first, float max_error)
+{
+    const float omega1m = 1.0f - omega;
+    for (int h = first; h < row.count; h++)
+    {
+        float lambda_new = row.ce[h]*row.east[h]  + row.cf[h]*row.west[h] +
+                           row.cg[h]*row.north[h] + row.ch[h]*row.south[h] +
+                           row.cm[h]*row.up[h]    + row.cn[h]*row.down[h] -
+                           row.rr[h] + omega1m*row.lambda[h];
+        float error = std::fabs(lambda_new - row.lambda[h]);
+        if (error > max_error)
+        {
+            max_error = error;
+        }
+        row.lambda[h] = lambda_new;
+    }
+    return max_error;
+}
+
+static float sorRowKernelScalar(const SORRow &row, float omega)
+{
+    return sorRowScalar(row, omega, 0, 0.0f);
+}
+
+
+#ifdef QES_SOR_X86
+
+__attribute__((target("avx2,fma")))
+static float sorRowKernelAVX2(const SORRow &row, float omega)
+{
+    const __m256 omega1m = _mm256_set1_ps(1.0f - omega);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 max_error = _mm256_setzero_ps();
+
+    int h = 0;
+    for (; h + 8 <= row.count; h += 8)
+    {
+        __m256 old = _mm256_loadu_ps(row.lambda + h);
+        __m256 acc = _mm256_mul_ps(omega1m, old);
+        acc = _mm256_sub_ps(acc, _mm256_loadu_ps(row.rr + h));
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(row.ce + h), _mm256_loadu_ps(row.east + h), acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(row.cf + h), _mm256_loadu_ps(row.west + h), acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(row.cg + h), _mm256_loadu_ps(row.north + h), acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(row.ch + h), _mm256_loadu_ps(row.south + h), acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(row.cm + h), _mm256_loadu_ps(row.up + h), acc);
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(row.cn + h), _mm256_loadu_ps(row.down + h), acc);
+        _mm256_storeu_ps(row.lambda + h, acc);
+
+        __m256 error = _mm256_andnot_ps(sign, _mm256_sub_ps(acc, old));
+        max_error = _mm256_max_ps(max_error, error);
+    }
+
+    // horizontal maximum of the 8 lanes
+    __m128 m4 = _mm_max_ps(_mm256_castps256_ps128(max_error), _mm256_extractf128_ps(max_error, 1));
+    m4 = _mm_max_ps(m4, _mm_movehl_ps(m4, m4));
+    m4 = _mm_max_ss(m4, _mm_shuffle_ps(m4, m4, 1));
+
+    return sorRowScalar(row, omega, h, _mm_cvtss_f32(m4));
+}
+
+__attribute__((target("avx512f")))
+static float sorRowKernelAVX512(const SORRow &row, float omega)
+{
+    const __m512 omega1m = _mm512_set1_ps(1.0f - omega);
+    __m512 max_error = _mm512_setzero_ps();
+
+    int h = 0;
+    for (; h + 16 <= row.count; h += 16)
+    {
+        __m512 old = _mm512_loadu_ps(row.lambda + h);
+        __m512 acc = _mm512_mul_ps(omega1m, old);
+        acc = _mm512_sub_ps(acc, _mm512_loadu_ps(row.rr + h));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(row.ce + h), _mm512_loadu_ps(row.east + h), acc);
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(row.cf + h), _mm512_loadu_ps(row.west + h), acc);
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(row.cg + h), _mm512_loadu_ps(row.north + h), acc);
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(row.ch + h), _mm512_loadu_ps(row.south + h), acc);
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(row.cm + h), _mm512_loadu_ps(row.up + h), acc);
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(row.cn + h), _mm512_loadu_ps(row.down + h), acc);
+        _mm512_storeu_ps(row.lambda + h, acc);
+
+        __m512 error = _mm512_abs_ps(_mm512_sub_ps(acc, old));
+        max_error = _mm512_mask_max_ps(max_error, 0xFFFF, max_error, error);
+    }
+
+    // horizontal maximum of the 16 lanes
+    float lanes[16];
+    _mm512_storeu_ps(lanes, max_error);
+    float row_max = 0.0f;
+    for (int l = 0; l < 16; l++)
+    {
+        row_max = (lanes[l] > row_max) ? lanes[l] : row_max;
+    }
+
+    return sorRowScalar(row, omega, h, row_max);
+}
+
+#endif
+
+
+bool sorKernelSupported(SORKernelType type)
+{
+    switch (type)
+    {
+    case SOR_Scalar:
+        return true;
+#ifdef QES_SOR_X86
+    case SOR_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case SOR_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+SORRowKernel sorKernel(SORKernelType type)
+{
+    if (!sorKernelSupported(type))
+    {
+        return sorRowKernelScalar;
+    }
+
+    switch (type)
+    {
+#ifdef QES_SOR_X86
+    case SOR_AVX2:
+        return sorRowKernelAVX2;
+    case SOR_AVX512:
+        return sorRowKernelAVX512;
+#endif
+    default:
+        return sorRowKernelScalar;
+    }
+}
+
+SORKernelType bestSORKernel()
+{
+    if (sorKernelSupported(SOR_AVX512))
+    {
+        return SOR_AVX512;
+    }
+    if (sorKernelSupported(SOR_AVX2))
+    {
+        return SOR_AVX2;
+    }
+    return SOR_Scalar;
+}
+
+std::string sorKernelName(SORKernelType type)
+{
+    switch (type)
+    {
+    case SOR_AVX2:
+        return "AVX2";
+    case SOR_AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * Row kernels for the red-black SOR update on color-split storage,
+ * with SIMD versions selected at runtime from the CPU features.
+ */
+
+#include <string>
+
+
+/**
+ * Arguments of one row update.  All pointers are already offset to
+ * the first cell of the row being updated; the cells of one color are
+ * contiguous, so every stream is read with unit stride.
+ *
+ * The coefficients are premultiplied by omega/(e+f+g+h+m+n) and the
+ * divergence term as well, so the update of one cell is
+ *
+ *   lambda = ce*east + cf*west + cg*north + ch*south + cm*up + cn*down
+ *            - rr + (1-omega)*lambda
+ */
+struct SORRow
+{
+    float *lambda;                 /**< Cells being updated */
+    const float *east, *west;      /**< Other color, i+1 and i-1 */
+    const float *north, *south;    /**< Other color, j+1 and j-1 */
+    const float *up, *down;        /**< Other color, k+1 and k-1 */
+    const float *ce, *cf, *cg, *ch, *cm, *cn;   /**< Scaled coefficients */
+    const float *rr;               /**< Scaled divergence */
+    int count;                     /**< Number of cells in the row */
+};
+
+/**
+ * Updates one row and returns the largest change of lambda.
+ */
+typedef float (*SORRowKernel)(const SORRow &row, float omega);
+
+enum SORKernelType : int {SOR_Scalar = 0, SOR_AVX2 = 1, SOR_AVX512 = 2};
+
+/*
+ * Returns true if the kernel was compiled in and the CPU running the
+ * code supports it.
+ */
+bool sorKernelSupported(SORKernelType type);
+
+/*
+ * Returns the kernel of the given type (the scalar kernel if the type
+ * is not supported).
+ */
+SORRowKernel sorKernel(SORKernelType type);
+
+/*
+ * Returns the widest kernel supported by the CPU running the code.
+ */
+SORKernelType bestSORKernel();
+
+/*
+ * Name of the kernel type, for output.
+ */
+std::string sorKernelName(SORKernelType type);
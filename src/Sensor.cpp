@@ -43,6 +43,8 @@
 
 #include "WINDSInputData.h"
 #include "WINDSGeneralData.h"
+#include "handleWINDSArgs.h"
+#include "Timers.h"
 
 
 using namespace std;
@@ -52,6 +54,7 @@ using namespace std;
 
 void Sensor::inputWindProfile(const WINDSInputData *WID, WINDSGeneralData *WGD, int index, int solverType)
 {
+	ScopedTimer timer("sensor profiles");
 
 	const float vk = 0.4;			/// Von Karman's constant
 	float canopy_d, u_H;
@@ -405,7 +408,8 @@ void Sensor::inputWindProfile(const WINDSInputData *WID, WINDSGeneralData *WGD,
 	// Apply 2D Barnes scheme to interpolate site velocity profiles to the whole domain
 	else
 	{
-		if (solverType == 1)
+		// Only the GPU solvers use the GPU version of the interpolation
+		if (solverType != DYNAMIC_P && solverType != Global_M && solverType != Shared_M)
 		{
 			auto startBarnesCPU = std::chrono::high_resolution_clock::now();
 			BarnesInterpolationCPU (WID, WGD, u_prof, v_prof);
@@ -400,3 +400,47 @@ void PolyBuilding::sideWall (const WINDSInputData* WID, WINDSGeneralData* WGD)
     }
   }
 }
+
+
+/**
+*
+* This function gives the cells that the sidewall may read or write: the recirculation regions start
+* at the nodes of the faces nominally parallel to the wind at the roof centroid (with a margin for the
+* rounding) and are at most the face (or the vortex length) long.
+*
+*/
+void PolyBuilding::sideWallCells (const WINDSGeneralData* WGD, CellBox &box) const
+{
+  float tol = 10*M_PI/180.0+0.001;
+  int index_building_face = i_building_cent + j_building_cent*WGD->nx + (k_end)*WGD->nx*WGD->ny;
+  float upwind_dir = atan2(WGD->v0[index_building_face], WGD->u0[index_building_face]);
+
+  float R_scale_side = pow(MIN_S(width_eff, H), (2.0/3.0))*pow(MAX_S(width_eff, H), (1.0/3.0));
+  float R_cx_side = 0.9*R_scale_side;
+  float y_pref = 0.5*0.22*R_scale_side/sqrt(0.5*R_cx_side);
+
+  for (auto id = 0; id < polygonVertices.size()-1; id++)
+  {
+    float x_rot = (polygonVertices[id+1].x_poly-polygonVertices[id].x_poly)*cos(upwind_dir)
+                 +(polygonVertices[id+1].y_poly-polygonVertices[id].y_poly)*sin(upwind_dir);
+    float y_rot = -(polygonVertices[id+1].x_poly-polygonVertices[id].x_poly)*sin(upwind_dir)
+                  +(polygonVertices[id+1].y_poly-polygonVertices[id].y_poly)*cos(upwind_dir);
+    float face_rel_dir = atan2(y_rot, x_rot) + 0.5*M_PI;
+    if (face_rel_dir > M_PI)
+    {
+      face_rel_dir -= 2*M_PI;
+    }
+    if (abs(face_rel_dir) >= 0.5*M_PI-tol && abs(face_rel_dir) <= 0.5*M_PI+tol)
+    {
+      float face_length = sqrt(pow(polygonVertices[id+1].x_poly-polygonVertices[id].x_poly, 2.0) +
+                               pow(polygonVertices[id+1].y_poly-polygonVertices[id].y_poly, 2.0));
+      float x_reach = MAX_S(face_length, R_cx_side) + WGD->dxy;
+      float reach = x_reach + y_pref*sqrt(x_reach) + 2*WGD->dxy;
+      for (auto n = id; n <= id+1; n++)
+      {
+        box.addPoint(polygonVertices[n].x_poly-reach, polygonVertices[n].y_poly-reach, WGD->dx, WGD->dy, k_start, k_end-1);
+        box.addPoint(polygonVertices[n].x_poly+reach, polygonVertices[n].y_poly+reach, WGD->dx, WGD->dy, k_start, k_end-1);
+      }
+    }
+  }
+}
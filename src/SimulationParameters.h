@@ -43,7 +43,8 @@
 #include "Vector3.h"
 #include "DTEHeightField.h"
 #include "ESRIShapefile.h"
-#include "Mesh.h"
+#include "GeometryCache.h"
+#include "Timers.h"
 
 class SimulationParameters : public ParseInterface
 {
@@ -64,6 +65,13 @@ public:
     int sidewallFlag = 1;
     int maxIterations = 500;
     double tolerance = 1e-9;
+    int pcgPreconditioner = 2;      // PCG solver preconditioner (1-Jacobi, 2-symmetric Gauss-Seidel)
+    int convergenceCheckInterval = 1;   // Iterations between convergence checks of the serial solver
+    int warmStart = 0;              // Initial guess of the solver (-1-zero, 0-solver default, 1-previous time step, 2-extrapolated from the last two steps)
+    int batchScenarios = 1;         // Time steps (inflow scenarios) solved together by the serial solver
+    float parameterizationDirTolerance = 0.0;     // Change of the wind direction (degrees) at a building below which its
+                                                  // parameterizations are replayed from the previous time steps (0 for none)
+    float parameterizationSpeedTolerance = 0.1;   // Relative change of the wind speed at a building below which they are replayed
     float domainRotation = 0;
     int originFlag = 0;
     float UTMx;
@@ -72,6 +80,8 @@ public:
     int UTMZoneLetter;
     float DEMDistancex = 0.0;
     float DEMDistancey = 0.0;
+    int DEMOverviews = 0;           // Read the DEM from its overviews when the cells are larger than the pixels (1) or not (0)
+    float DEMMaxError = 0.0;        // Maximum vertical error (m) of the decimated terrain mesh (0 for the full mesh)
     int meshTypeFlag = 0;
     float halo_x = 0.0;
     float halo_y = 0.0;
@@ -79,11 +89,11 @@ public:
 
     int readCoefficientsFlag = 0;
     std::string coeffFile;
+    int compressCoefficientsFlag = 0;   // Keep the solver coefficients in compressed form (1) or full arrays (0)
 
     // DTE - digital elevation model details
     std::string demFile;    // DEM file name
     DTEHeightField* DTE_heightField = nullptr;
-    Mesh* DTE_mesh;
 
     // SHP File parameters
     std::string shpFile;   // SHP file name
@@ -93,6 +103,10 @@ public:
     std::vector <float> shpBuildingHeight;        // Height of
                                                   // buildings
 
+    // Cache of the preprocessed geometry (terrain, cell flags, walls
+    // and solver coefficients), reused by the runs with the same inputs
+    std::string geometryCacheDir;   // Directory of the cache files ("" for no cache)
+    GeometryCache* geometryCache = nullptr;
 
 
     enum DomainInputType {
@@ -114,6 +128,8 @@ public:
         // close the scanner
         if (DTE_heightField)
             DTE_heightField->closeScanner();
+
+        delete geometryCache;
     }
 
 
@@ -132,6 +148,12 @@ public:
         parsePrimitive<int>(false, sidewallFlag, "sidewallFlag");
         parsePrimitive<int>(false, maxIterations, "maxIterations");
         parsePrimitive<double>(false, tolerance, "tolerance");
+        parsePrimitive<int>(false, pcgPreconditioner, "pcgPreconditioner");
+        parsePrimitive<int>(false, convergenceCheckInterval, "convergenceCheckInterval");
+        parsePrimitive<int>(false, warmStart, "warmStart");
+        parsePrimitive<int>(false, batchScenarios, "batchScenarios");
+        parsePrimitive<float>(false, parameterizationDirTolerance, "parameterizationDirTolerance");
+        parsePrimitive<float>(false, parameterizationSpeedTolerance, "parameterizationSpeedTolerance");
         parsePrimitive<int>(false, meshTypeFlag, "meshTypeFlag");
         parsePrimitive<float>(false, domainRotation, "domainRotation");
         parsePrimitive<int>(false, originFlag, "originFlag");
@@ -141,11 +163,14 @@ public:
         parsePrimitive<int>(false, UTMZoneLetter, "UTMZoneLetter");
         parsePrimitive<float>(false, DEMDistancex, "DEMDistancex");
         parsePrimitive<float>(false, DEMDistancey, "DEMDistancey");
+        parsePrimitive<int>(false, DEMOverviews, "DEMOverviews");
+        parsePrimitive<float>(false, DEMMaxError, "DEMMaxError");
 
         parsePrimitive<float>(false, halo_x, "halo_x");
         parsePrimitive<float>(false, halo_y, "halo_y");
         parsePrimitive<float>(false, heightFactor, "heightFactor");
         parsePrimitive<int>(false, readCoefficientsFlag, "readCoefficientsFlag");
+        parsePrimitive<int>(false, compressCoefficientsFlag, "compressCoefficientsFlag");
 
         coeffFile = "";
         parsePrimitive<std::string>(false, coeffFile, "COEFF");
@@ -159,6 +184,9 @@ public:
         shpBuildingLayerName = "buildings";  // defaults
         parsePrimitive<std::string>(false, shpBuildingLayerName, "SHPBuildingLayer");
 
+        geometryCacheDir = "";
+        parsePrimitive<std::string>(false, geometryCacheDir, "geometryCache");
+
         // Determine which use case to use for WRF/DEM combinations
         if (demFile != "") {
             // Only DEM Specified - nothing set for WRF Input
@@ -172,23 +200,10 @@ public:
         // Process the data files based on the state determined above
         //
         
-        if (m_domIType == DEMOnly) {
-            std::cout << "Extracting Digital Elevation Data from " << demFile << std::endl;
-            DTE_heightField = new DTEHeightField(demFile,
-                                                 (*(grid))[0],(*(grid))[1], UTMx, UTMy, 
-                                                  originFlag, DEMDistancex, DEMDistancey,
-                                                  (*(domain))[0],(*(domain))[1]);
-            assert(DTE_heightField);
-
-            std::cout << "Forming triangle mesh...\n";
-            DTE_heightField->setDomain(domain, grid);
-            DTE_mesh = new Mesh(DTE_heightField->getTris());
-            std::cout << "Mesh complete\n";
-        }
-        else {
-            // No DEM, so make sure these are null
-            DTE_heightField = nullptr;
-            DTE_mesh = nullptr;
+        // With a geometry cache, the DEM is only loaded when the cache
+        // misses (see openGeometryCache)
+        if (geometryCacheDir == "") {
+            loadTerrain();
         }
 
         //
@@ -197,10 +212,93 @@ public:
         //
         SHPData = nullptr;
         if (shpFile != "") {
+            ScopedTimer timer("shapefile loading");
 
             // Read polygon node coordinates and building height from shapefile
             SHPData = new ESRIShapefile( shpFile, shpBuildingLayerName,
                                          shpPolygons, shpBuildingHeight, heightFactor );
         }
     }
+
+    /*
+     * Loads the DEM and forms the terrain mesh, if there is a DEM and
+     * it has not been loaded yet.
+     */
+    void loadTerrain()
+    {
+        if (m_domIType != DEMOnly || DTE_heightField) {
+            return;
+        }
+
+        ScopedTimer timer("DEM loading");
+
+        std::cout << "Extracting Digital Elevation Data from " << demFile << std::endl;
+        DTE_heightField = new DTEHeightField(demFile,
+                                             (*(grid))[0],(*(grid))[1], UTMx, UTMy,
+                                              originFlag, DEMDistancex, DEMDistancey,
+                                              (*(domain))[0],(*(domain))[1], DEMOverviews == 1);
+        assert(DTE_heightField);
+
+        std::cout << "Forming triangle mesh...\n";
+        DTE_heightField->setDomain(domain, grid);
+        if (DEMMaxError > 0.0) {
+            ScopedTimer timer("terrain decimation");
+            DTE_heightField->decimate(DEMMaxError);
+        }
+        std::cout << "Mesh complete\n";
+    }
+
+    /*
+     * Opens the geometry cache file of the inputs of the geometry: the
+     * DEM, the shapefile, the grid and the flags of the geometry, plus
+     * the other inputs given (the buildings and canopies of the XML
+     * file). The DEM is loaded only when there is no cache file for
+     * these inputs.
+     *
+     * @param otherInputs -other inputs of the geometry
+     */
+    void openGeometryCache(const std::string &otherInputs)
+    {
+        GeometryCache::Hash hash;
+        for (int i = 0; i < 3; i++) {
+            hash.add((*domain)[i]);
+            hash.add((*grid)[i]);
+        }
+        hash.add(verticalStretching);
+        hash.add(dz_value);
+        hash.add(meshTypeFlag);
+        hash.add(originFlag);
+        hash.add(UTMx);
+        hash.add(UTMy);
+        hash.add(DEMDistancex);
+        hash.add(DEMDistancey);
+        hash.add(DEMOverviews);
+        hash.add(halo_x);
+        hash.add(halo_y);
+        hash.add(heightFactor);
+        hash.add(readCoefficientsFlag);
+        if (readCoefficientsFlag == 1) {
+            hash.addFile(coeffFile);
+        }
+        if (demFile != "") {
+            hash.addFile(demFile);
+        }
+        if (shpFile != "") {
+            // The building heights are in the attribute (.dbf) file
+            std::string base = shpFile.substr(0, shpFile.rfind('.'));
+            hash.addFile(shpFile);
+            hash.addFile(base + ".shx");
+            hash.addFile(base + ".dbf");
+            hash.add(shpBuildingLayerName);
+        }
+        hash.add(otherInputs);
+
+        geometryCache = new GeometryCache(geometryCacheDir, hash.value());
+        if (geometryCache->isLoaded()) {
+            std::cout << "Geometry cache found: " << geometryCache->getFileName() << std::endl;
+        }
+        else {
+            loadTerrain();
+        }
+    }
 };
@@ -67,8 +67,130 @@ Solver::Solver(const WINDSInputData* WID, WINDSGeneralData * WGD)
       eta( pow((alpha1/alpha2), 2.0) ),
       A( pow( (WGD->dx/WGD->dy), 2.0 ) ),
       B( eta*pow( (WGD->dx/WGD->dz), 2.0) ),
-      itermax( WID->simParams->maxIterations )
+      itermax( WID->simParams->maxIterations ),
+      convergenceInterval( MAX_S(1, WID->simParams->convergenceCheckInterval) ),
+      iterations( 0 ),
+      warmStart( WID->simParams->warmStart )
 
 {
   tol = WID->simParams->tolerance;
 }
+
+
+/**< \fn initialGuess
+* This function is setting the starting value of lambda.  With warm start
+* the solution of the previous time step is reused; with extrapolation the
+* guess is 2*lambda(n-1) - lambda(n-2), which is exact for winds changing
+* linearly in time.  Without warm start, solvers that always kept lambda
+* between solves (reusePrevious) still do so, unless cold start is asked.
+ */
+
+bool Solver::initialGuess(WINDSGeneralData* WGD, bool reusePrevious)
+{
+  if (warmStart == 0 && reusePrevious)
+  {
+    bool warm = lambda.size() == (size_t)WGD->numcell_cent;
+    lambda.resize( WGD->numcell_cent, 0.0 );
+    lambda_prev.clear();
+    return warm;
+  }
+
+  if (warmStart <= 0 || lambda.size() != (size_t)WGD->numcell_cent)
+  {
+    lambda.assign( WGD->numcell_cent, 0.0 );
+    lambda_prev.clear();
+    return false;
+  }
+
+  if (warmStart >= 2)
+  {
+    if (lambda_prev.size() == lambda.size())
+    {
+      for (size_t id = 0; id < lambda.size(); id++)
+      {
+        float last = lambda[id];
+        lambda[id] = 2.0*last - lambda_prev[id];
+        lambda_prev[id] = last;
+      }
+    }
+    else
+    {
+      // Only one previous solution: reuse it and keep it for the next step
+      lambda_prev = lambda;
+    }
+  }
+
+  return true;
+}
+
+
+/**< \fn loadCoefficients
+* This function is pointing coeff to the coefficient arrays of the solve.
+* Compressed coefficients are expanded once into the working arrays of the
+* solver.
+ */
+
+void Solver::loadCoefficients(WINDSGeneralData* WGD)
+{
+  if (WGD->compressedCoeff == nullptr)
+  {
+    coeff = {WGD->e.data(), WGD->f.data(), WGD->g.data(), WGD->h.data(), WGD->m.data(), WGD->n.data()};
+    return;
+  }
+
+  if (work_e.size() != (size_t)WGD->numcell_cent)
+  {
+    WGD->compressedCoeff->expand(work_e, work_f, work_g, work_h, work_m, work_n);
+  }
+  coeff = {work_e.data(), work_f.data(), work_g.data(), work_h.data(), work_m.data(), work_n.data()};
+}
+
+
+/**< \fn zeroSolidVelocities
+* This function is setting the velocities on all faces of the solid cells
+* (terrain and buildings) to zero.  It loops over the faces, so that each
+* face is only written by the thread of its own k-level.
+ */
+
+void Solver::zeroSolidVelocities(WINDSGeneralData* WGD)
+{
+  const int nx = WGD->nx;
+  const int ny = WGD->ny;
+  const int nz = WGD->nz;
+
+  // Only the cells between k = 1 and nz-2 are checked, as in the solve
+  auto solid = [&](int i, int j, int k)
+  {
+    if (k < 1 || k > nz-2)
+    {
+      return false;
+    }
+    int flag = WGD->icellflag[i + j*(nx-1) + k*(nx-1)*(ny-1)];
+    return flag == 0 || flag == 2;
+  };
+
+#pragma omp parallel for schedule(static)
+  for (int k = 1; k < nz; k++)
+  {
+    for (int j = 0; j < ny; j++)
+    {
+      for (int i = 0; i < nx; i++)
+      {
+        int icell_face = i + j*nx + k*nx*ny;   /// Lineralized index for cell faced values
+
+        if (j < ny-1 && ((i > 0 && solid(i-1, j, k)) || (i < nx-1 && solid(i, j, k))))
+        {
+          WGD->u[icell_face] = 0;
+        }
+        if (i < nx-1 && ((j > 0 && solid(i, j-1, k)) || (j < ny-1 && solid(i, j, k))))
+        {
+          WGD->v[icell_face] = 0;
+        }
+        if (i < nx-1 && j < ny-1 && (solid(i, j, k-1) || solid(i, j, k)))
+        {
+          WGD->w[icell_face] = 0;
+        }
+      }
+    }
+  }
+}
@@ -81,6 +81,40 @@ protected:
     std::vector<float> lambda, lambda_old;
 
     int itermax;		/**< Maximum number of iterations */
+    int convergenceInterval;	/**< Number of iterations between convergence checks */
+    int iterations;		/**< Number of iterations of the last solve */
+
+    int warmStart;		/**< Initial guess (-1-zero, 0-solver default, 1-previous solution, 2-extrapolated from two solutions) */
+    std::vector<float> lambda_prev;	/**< Solution of the time step before the last one */
+
+    /*
+     * This sets the initial guess of lambda for a new solve.  Without
+     * warm start, or on the first solve, lambda starts from zero, except
+     * for solvers passing reusePrevious, which keep the last solution
+     * unless warmStart is -1 (cold start).
+     *
+     * @return true if lambda starts from a non-zero guess
+     */
+    bool initialGuess(WINDSGeneralData* WGD, bool reusePrevious = false);
+
+    /// Coefficient arrays (e,f,g,h,m,n) of the solve: the arrays of
+    /// WINDSGeneralData, or a working copy when these are compressed
+    struct CoefficientArrays
+    {
+        const float *e, *f, *g, *h, *m, *n;
+    } coeff;
+    std::vector<float> work_e, work_f, work_g, work_h, work_m, work_n;
+
+    /*
+     * This sets coeff for solvers that need the coefficients as full
+     * arrays, expanding the compressed coefficients if necessary.
+     */
+    void loadCoefficients(WINDSGeneralData* WGD);
+
+    /*
+     * This sets the velocities on the faces of the solid cells to zero.
+     */
+    void zeroSolidVelocities(WINDSGeneralData* WGD);
 
     /*
      * This prints out the current amount that a process
@@ -96,4 +130,9 @@ public:
 
     virtual void solve(const WINDSInputData *WID, WINDSGeneralData* WGD, bool solveWind) = 0;
 
+    /*
+     * @return the number of iterations (or cycles) of the last solve
+     */
+    int getIterations() const { return iterations; }
+
 };
@@ -68,10 +68,8 @@ void PolyBuilding::streetCanyon (WINDSGeneralData *WGD)
   float x_u, y_u, x_v, y_v, x_w, y_w;
   float x_pos;
   float x_p, y_p;
-  float cross_dir, x_ave, y_ave;
-  float x_down, y_down;
-  float segment_length;                     // Face length
-  float downwind_rel_dir, along_dir;
+  float cross_dir = 0.0;
+  float downwind_rel_dir, along_dir = 0.0;
   float cross_vel_mag, along_vel_mag;
   std::vector<int> perpendicular_flag;
   std::vector<float> perpendicular_dir;
@@ -295,79 +293,66 @@ void PolyBuilding::streetCanyon (WINDSGeneralData *WGD)
                               +building_cent_x-0.001)/WGD->dx)-1;
                 int j = ceil(((xc-0.5*WGD->dxy+x_wall)*sin(upwind_dir)+yc*cos(upwind_dir)
                               +building_cent_y-0.001)/WGD->dy)-1;
-                for (auto j_id = 0; j_id < WGD->allBuildingsV[d_build]->polygonVertices.size()-1; j_id++)
+                // First face of the downwind building next to the center of
+                // the cell (the last face if there is none)
+                const Building *downwind = WGD->allBuildingsV[d_build];
+                int face = downwind->findFace(i, j);
+                if (face >= 0)
                 {
-                  cross_dir = atan2(WGD->allBuildingsV[d_build]->polygonVertices[j_id+1].y_poly-WGD->allBuildingsV[d_build]->polygonVertices[j_id].y_poly,
-                                    WGD->allBuildingsV[d_build]->polygonVertices[j_id+1].x_poly-WGD->allBuildingsV[d_build]->polygonVertices[j_id].x_poly)+0.5*M_PI;
-
-                  if (cross_dir > M_PI+0.001)
+                  cross_dir = downwind->faces[face].cross_dir;
+                  downwind_rel_dir = canyon_dir-cross_dir;
+                  if (downwind_rel_dir > M_PI+0.001)
                   {
-                    cross_dir -= 2*M_PI;
+                    downwind_rel_dir -= 2*M_PI;
+                    if (abs(downwind_rel_dir) < 0.001)
+                    {
+                      downwind_rel_dir = 0.0;
+                    }
                   }
-                  x_ave = 0.5*(WGD->allBuildingsV[d_build]->polygonVertices[j_id+1].x_poly+WGD->allBuildingsV[d_build]->polygonVertices[j_id].x_poly);
-                  y_ave = 0.5*(WGD->allBuildingsV[d_build]->polygonVertices[j_id+1].y_poly+WGD->allBuildingsV[d_build]->polygonVertices[j_id].y_poly);
-
-                  x_down = ((i+0.5)*WGD->dx-x_ave)*cos(cross_dir) + ((j+0.5)*WGD->dy-y_ave)*sin(cross_dir);
-                  y_down = -((i+0.5)*WGD->dx-x_ave)*sin(cross_dir) + ((j+0.5)*WGD->dy-y_ave)*cos(cross_dir);
-
-                  if (abs(x_down) < 0.75*WGD->dxy)
+                  if (downwind_rel_dir <= -M_PI)
                   {
-                    segment_length = sqrt(pow(WGD->allBuildingsV[d_build]->polygonVertices[j_id+1].x_poly-WGD->allBuildingsV[d_build]->polygonVertices[j_id].x_poly, 2.0)
-                                          +pow(WGD->allBuildingsV[d_build]->polygonVertices[j_id+1].y_poly-WGD->allBuildingsV[d_build]->polygonVertices[j_id].y_poly, 2.0));
-                    if (abs(y_down) <= 0.5*segment_length)
+                    downwind_rel_dir += 2*M_PI;
+                    if (abs(downwind_rel_dir) < 0.001)
                     {
-                      downwind_rel_dir = canyon_dir-cross_dir;
-                      if (downwind_rel_dir > M_PI+0.001)
-                      {
-                        downwind_rel_dir -= 2*M_PI;
-                        if (abs(downwind_rel_dir) < 0.001)
-                        {
-                          downwind_rel_dir = 0.0;
-                        }
-                      }
-                      if (downwind_rel_dir <= -M_PI)
-                      {
-                        downwind_rel_dir += 2*M_PI;
-                        if (abs(downwind_rel_dir) < 0.001)
-                        {
-                          downwind_rel_dir = 0.0;
-                        }
-                      }
-                      if (abs(downwind_rel_dir) < 0.5*M_PI)
-                      {
-                        reverse_flag = 1;
-                        if (downwind_rel_dir >= 0.0)
-                        {
-                          along_dir = cross_dir-0.5*M_PI;
-                        }
-                        else
-                        {
-                          along_dir = cross_dir+0.5*M_PI;
-                        }
-                      }
-                      else
-                      {
-                        reverse_flag = 0;
-                        if (downwind_rel_dir >= 0.0)
-                        {
-                          along_dir = cross_dir+0.5*M_PI;
-                        }
-                        else
-                        {
-                          along_dir = cross_dir-0.5*M_PI;
-                        }
-                      }
-                      if (along_dir > M_PI+0.001)
-                      {
-                        along_dir -= 2*M_PI;
-                      }
-                      if (along_dir <= -M_PI)
-                      {
-                        along_dir += 2*M_PI;
-                      }
-                      break;
+                      downwind_rel_dir = 0.0;
+                    }
+                  }
+                  if (abs(downwind_rel_dir) < 0.5*M_PI)
+                  {
+                    reverse_flag = 1;
+                    if (downwind_rel_dir >= 0.0)
+                    {
+                      along_dir = cross_dir-0.5*M_PI;
+                    }
+                    else
+                    {
+                      along_dir = cross_dir+0.5*M_PI;
+                    }
+                  }
+                  else
+                  {
+                    reverse_flag = 0;
+                    if (downwind_rel_dir >= 0.0)
+                    {
+                      along_dir = cross_dir+0.5*M_PI;
+                    }
+                    else
+                    {
+                      along_dir = cross_dir-0.5*M_PI;
                     }
                   }
+                  if (along_dir > M_PI+0.001)
+                  {
+                    along_dir -= 2*M_PI;
+                  }
+                  if (along_dir <= -M_PI)
+                  {
+                    along_dir += 2*M_PI;
+                  }
+                }
+                else if (!downwind->faces.empty())
+                {
+                  cross_dir = downwind->faces.back().cross_dir;
                 }
                 if (cross_dir <= -M_PI)
                 {
@@ -500,3 +485,69 @@ void PolyBuilding::streetCanyon (WINDSGeneralData *WGD)
   }
 
 }
+
+
+/**
+*
+* This function gives the cells that the street canyon may read or write: the cells along the lines
+* followed from each eligible face for the current wind direction, up to Lr, and their neighbors (the
+* reference velocity is above the canyon and the w velocity checks the cell below).
+*
+*/
+void PolyBuilding::streetCanyonCells (const WINDSGeneralData* WGD, CellBox &box) const
+{
+  float tol = 0.01*M_PI/180.0;
+  float x_wall = 0.0, yc, rel_dir;
+  std::vector<float> x_rot, y_rot;       // Nodes in rotated coordinates (xi and yi in streetCanyon)
+
+  if (!(Lr > 0.0))
+  {
+    return;
+  }
+
+  int index_building_face = i_building_cent + j_building_cent*WGD->nx + (k_end)*WGD->nx*WGD->ny;
+  double u_h = WGD->u0[index_building_face];
+  double v_h = WGD->v0[index_building_face];
+  float dir = atan2(v_h,u_h);
+
+  x_rot.resize (polygonVertices.size(),0.0);
+  y_rot.resize (polygonVertices.size(),0.0);
+  for (auto id=0; id<polygonVertices.size(); id++)
+  {
+    x_rot[id] = (polygonVertices[id].x_poly-building_cent_x)*cos(dir)
+               +(polygonVertices[id].y_poly-building_cent_y)*sin(dir);
+    y_rot[id] = -(polygonVertices[id].x_poly-building_cent_x)*sin(dir)
+               +(polygonVertices[id].y_poly-building_cent_y)*cos(dir);
+  }
+
+  // Last point followed from the faces
+  float x_end = ceil(Lr/WGD->dxy)*WGD->dxy;
+  for (auto id=0; id<polygonVertices.size()-1; id++)
+  {
+    rel_dir = atan2(y_rot[id+1]-y_rot[id],x_rot[id+1]-x_rot[id])+0.5*M_PI;
+    if (rel_dir > M_PI)
+    {
+      rel_dir -= 2*M_PI;
+    }
+    if ( abs(rel_dir) < 0.5*M_PI-0.0001)
+    {
+      bool perpendicular = (abs(rel_dir) > M_PI-tol || abs(rel_dir) < tol);
+      if (perpendicular)
+      {
+        x_wall = x_rot[id];
+      }
+      for (auto y_id=0; y_id <= 2*ceil(abs(y_rot[id]-y_rot[id+1])/WGD->dxy); y_id++)
+      {
+        yc = MIN_S(y_rot[id],y_rot[id+1])+0.5*y_id*WGD->dxy;
+        if (!perpendicular)
+        {
+          x_wall = ((x_rot[id+1]-x_rot[id])/(y_rot[id+1]-y_rot[id]))*(yc-y_rot[id])+x_rot[id];
+        }
+        box.addPoint((0.5*WGD->dxy+x_wall)*cos(dir)-yc*sin(dir)+building_cent_x,
+                     (0.5*WGD->dxy+x_wall)*sin(dir)+yc*cos(dir)+building_cent_y, WGD->dx, WGD->dy, k_start-1, k_end);
+        box.addPoint((x_end+x_wall)*cos(dir)-yc*sin(dir)+building_cent_x,
+                     (x_end+x_wall)*sin(dir)+yc*cos(dir)+building_cent_y, WGD->dx, WGD->dy, k_start-1, k_end);
+      }
+    }
+  }
+}
@@ -0,0 +1,189 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#include "Timers.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+TimerRegistry& TimerRegistry::instance()
+{
+    static TimerRegistry registry;
+    return registry;
+}
+
+
+TimerRegistry::TimerRegistry()
+    : phases(1), current(0)
+{
+    // The root phase covers the whole run
+    phases[0].name = "qesWinds";
+    phases[0].parent = -1;
+    phases[0].count = 1;
+    phases[0].open = true;
+    phases[0].started = Clock::now();
+}
+
+
+void TimerRegistry::start(const char *name)
+{
+    int id = -1;
+    for (size_t c = 0; c < phases[current].children.size(); c++)
+    {
+        if (phases[phases[current].children[c]].name == name)
+        {
+            id = phases[current].children[c];
+            break;
+        }
+    }
+
+    if (id < 0)
+    {
+        id = phases.size();
+        phases.push_back(Phase());
+        phases[id].name = name;
+        phases[id].parent = current;
+        phases[current].children.push_back(id);
+    }
+
+    phases[id].open = true;
+    current = id;
+    phases[id].started = Clock::now();
+}
+
+
+void TimerRegistry::stop()
+{
+    if (current <= 0)
+    {
+        std::cerr << "[WARNING] TimerRegistry: stop() without a matching start()" << std::endl;
+        return;
+    }
+
+    Phase &phase = phases[current];
+    double elapsed = std::chrono::duration<double>(Clock::now() - phase.started).count();
+
+    if (phase.count == 0 || elapsed < phase.min)
+    {
+        phase.min = elapsed;
+    }
+    if (phase.count == 0 || elapsed > phase.max)
+    {
+        phase.max = elapsed;
+    }
+    phase.total += elapsed;
+    phase.count++;
+    phase.open = false;
+
+    current = phase.parent;
+}
+
+
+void TimerRegistry::writeJSON(std::ostream &out) const
+{
+    out << std::setprecision(6);
+    writePhase(out, 0, Clock::now(), 0);
+    out << "\n";
+}
+
+
+bool TimerRegistry::writeJSON(const std::string &fileName) const
+{
+    std::ofstream out(fileName.c_str());
+    if (!out.is_open())
+    {
+        std::cerr << "[ERROR] Unable to write the timing report " << fileName << std::endl;
+        return false;
+    }
+    writeJSON(out);
+    return true;
+}
+
+
+void TimerRegistry::writePhase(std::ostream &out, int id, const Clock::time_point &now, int depth) const
+{
+    const Phase &phase = phases[id];
+    std::string indent(2*depth, ' ');
+
+    // A phase still open counts as one more call lasting up to now
+    long count = phase.count;
+    double total = phase.total, min = phase.min, max = phase.max;
+    if (id == 0)
+    {
+        total = min = max = std::chrono::duration<double>(now - phase.started).count();
+    }
+    else if (phase.open)
+    {
+        double elapsed = std::chrono::duration<double>(now - phase.started).count();
+        min = (count == 0) ? elapsed : std::min(min, elapsed);
+        max = (count == 0) ? elapsed : std::max(max, elapsed);
+        total += elapsed;
+        count++;
+    }
+
+    std::string name;
+    for (size_t c = 0; c < phase.name.size(); c++)
+    {
+        if (phase.name[c] == '"' || phase.name[c] == '\\')
+        {
+            name += '\\';
+        }
+        name += phase.name[c];
+    }
+
+    // Times are in seconds
+    out << indent << "{\n"
+        << indent << "  \"name\": \"" << name << "\",\n"
+        << indent << "  \"count\": " << count << ",\n"
+        << indent << "  \"total\": " << total << ",\n"
+        << indent << "  \"mean\": " << (count > 0 ? total/count : 0.0) << ",\n"
+        << indent << "  \"min\": " << min << ",\n"
+        << indent << "  \"max\": " << max << ",\n"
+        << indent << "  \"children\": [";
+
+    for (size_t c = 0; c < phase.children.size(); c++)
+    {
+        out << (c == 0 ? "\n" : ",\n");
+        writePhase(out, phase.children[c], now, depth+2);
+    }
+    if (!phase.children.empty())
+    {
+        out << "\n" << indent << "  ";
+    }
+    out << "]\n" << indent << "}";
+}
@@ -0,0 +1,138 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+
+#pragma once
+
+/*
+ * Registry of scoped timers used to profile the phases of a run.
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+
+
+/**
+ * Hierarchical phase timer
+ *
+ * A phase is opened with start() and closed with stop(), usually
+ * through a ScopedTimer.  Phases started while another one is open
+ * are nested in it; a phase is identified by its name and its parent,
+ * so the same name can be used in different places of the tree.  For
+ * each phase the number of calls and the total, min and max time are
+ * kept, and the whole tree can be written as a JSON report.
+ *
+ * The timers are meant for the main thread, they must not be used
+ * inside OpenMP parallel regions.
+ */
+class TimerRegistry
+{
+public:
+
+    /*
+     * @return the registry of the run
+     */
+    static TimerRegistry& instance();
+
+    /*
+     * Opens the phase name nested in the current phase.
+     */
+    void start(const char *name);
+
+    /*
+     * Closes the current phase.
+     */
+    void stop();
+
+    /*
+     * Writes the timing tree as JSON.  Phases still open (such as the
+     * whole run) are reported up to now.
+     */
+    void writeJSON(std::ostream &out) const;
+
+    /*
+     * Writes the JSON report to a file.
+     *
+     * @return false if the file can't be opened
+     */
+    bool writeJSON(const std::string &fileName) const;
+
+private:
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct Phase
+    {
+        std::string name;
+        int parent;                     /**< Index of the enclosing phase, -1 for the root */
+        std::vector<int> children;
+        long count = 0;                 /**< Number of calls */
+        double total = 0.0;             /**< Total time (s) */
+        double min = 0.0;               /**< Shortest call (s) */
+        double max = 0.0;               /**< Longest call (s) */
+        bool open = false;
+        Clock::time_point started;
+    };
+
+    TimerRegistry();
+
+    void writePhase(std::ostream &out, int id, const Clock::time_point &now, int depth) const;
+
+    std::vector<Phase> phases;          /**< Phase tree, the root is phases[0] */
+    int current;                        /**< Innermost open phase */
+};
+
+
+/**
+ * Times the enclosing scope as a phase of the TimerRegistry.
+ */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char *name)
+    {
+        TimerRegistry::instance().start(name);
+    }
+
+    ~ScopedTimer()
+    {
+        TimerRegistry::instance().stop();
+    }
+
+private:
+    ScopedTimer(const ScopedTimer&);
+    ScopedTimer& operator=(const ScopedTimer&);
+};
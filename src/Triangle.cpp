@@ -39,12 +39,20 @@
 #define I 1.0f
 
 float Triangle::getHeightTo(float x, float y)
+{
+   const float pa[3] = {(*a)[0], (*a)[1], (*a)[2]};
+   const float pb[3] = {(*b)[0], (*b)[1], (*b)[2]};
+   const float pc[3] = {(*c)[0], (*c)[1], (*c)[2]};
+   return getHeightTo(pa, pb, pc, x, y);
+}
+
+float Triangle::getHeightTo(const float a[3], const float b[3], const float c[3], float x, float y)
 {
    float t, beta, gamma, M;
    float A,B,C,D,E,F,J,K,L;
-   A = (*a)[0] - (*b)[0];   D = (*a)[0] - (*c)[0];   J = (*a)[0] - x;
-   B = (*a)[1] - (*b)[1];   E = (*a)[1] - (*c)[1];   K = (*a)[1] - y;
-   C = (*a)[2] - (*b)[2];   F = (*a)[2] - (*c)[2];   L = (*a)[2];
+   A = a[0] - b[0];   D = a[0] - c[0];   J = a[0] - x;
+   B = a[1] - b[1];   E = a[1] - c[1];   K = a[1] - y;
+   C = a[2] - b[2];   F = a[2] - c[2];   L = a[2];
 
    float EIHF = (E * I - H * F);
    float GFDI = (G * F - D * I);
@@ -73,6 +73,12 @@ public:
 	 */
 	float getHeightTo(float x, float y);
 
+	/*
+	 * Same ray cast for the triangle with corners a, b and c, given as
+	 * {x, y, z}.
+	 */
+	static float getHeightTo(const float a[3], const float b[3], const float c[3], float x, float y);
+
 
 	/*
 	 * gets the minimum and maximum values in the x y and z dimensions
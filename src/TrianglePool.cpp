@@ -0,0 +1,138 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "TrianglePool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+/*
+ * Bit patterns of the coordinates of a vertex, with -0 as 0
+ */
+struct VertexKey
+{
+   uint32_t c[3];
+
+   VertexKey(float x, float y, float z)
+   {
+      float v[3] = { x + 0.0f, y + 0.0f, z + 0.0f };
+      std::memcpy(c, v, sizeof(c));
+   }
+
+   bool operator==(const VertexKey &other) const
+   {
+      return c[0] == other.c[0] && c[1] == other.c[1] && c[2] == other.c[2];
+   }
+};
+
+struct VertexKeyHash
+{
+   size_t operator()(const VertexKey &key) const
+   {
+      uint64_t h = key.c[0];
+      h = h * 0x9E3779B97F4A7C15ull ^ key.c[1];
+      h = h * 0x9E3779B97F4A7C15ull ^ key.c[2];
+      return (size_t)(h ^ (h >> 29));
+   }
+};
+
+}
+
+void TrianglePool::reserve(int numVertices, int numTriangles)
+{
+   x.reserve(numVertices);
+   y.reserve(numVertices);
+   z.reserve(numVertices);
+   corners.reserve(3 * numTriangles);
+}
+
+void TrianglePool::clear()
+{
+   x.clear();
+   y.clear();
+   z.clear();
+   corners.clear();
+}
+
+int TrianglePool::addVertex(float vx, float vy, float vz)
+{
+   x.push_back(vx);
+   y.push_back(vy);
+   z.push_back(vz);
+   return x.size() - 1;
+}
+
+void TrianglePool::addTriangle(int a, int b, int c)
+{
+   corners.push_back(a);
+   corners.push_back(b);
+   corners.push_back(c);
+}
+
+void TrianglePool::weld(std::vector<int> &vertexMap, std::vector<int> &welded) const
+{
+   int n = numVertices();
+   vertexMap.resize(n);
+   welded.clear();
+
+   std::unordered_map<VertexKey, int, VertexKeyHash> index;
+   index.reserve(n);
+   for (int i = 0; i < n; i++)
+   {
+      auto found = index.insert(std::make_pair(VertexKey(x[i], y[i], z[i]), (int)welded.size()));
+      if (found.second)
+         welded.push_back(i);
+      vertexMap[i] = found.first->second;
+   }
+}
+
+void TrianglePool::getBoundaries(int t, float& xmin, float& xmax, float& ymin, float& ymax, float& zmin, float& zmax) const
+{
+   int a = corners[3 * t], b = corners[3 * t + 1], c = corners[3 * t + 2];
+   xmin = LOWEST_OF_THREE(x[a], x[b], x[c]);
+   xmax = HIGHEST_OF_THREE(x[a], x[b], x[c]);
+   ymin = LOWEST_OF_THREE(y[a], y[b], y[c]);
+   ymax = HIGHEST_OF_THREE(y[a], y[b], y[c]);
+   zmin = LOWEST_OF_THREE(z[a], z[b], z[c]);
+   zmax = HIGHEST_OF_THREE(z[a], z[b], z[c]);
+}
+
+float TrianglePool::getHeightTo(int t, float px, float py) const
+{
+   float a[3], b[3], c[3];
+   getCorners(t, a, b, c);
+   return Triangle::getHeightTo(a, b, c, px, py);
+}
@@ -0,0 +1,116 @@
+/*
+ * QES-Winds
+ *
+ * Copyright (c) 2021 University of Utah
+ * Copyright (c) 2021 University of Minnesota Duluth
+ *
+ * Copyright (c) 2021 Behnam Bozorgmehr
+ * Copyright (c) 2021 Jeremy A. Gibbs
+ * Copyright (c) 2021 Fabien Margairaz
+ * Copyright (c) 2021 Eric R. Pardyjak
+ * Copyright (c) 2021 Zachary Patterson
+ * Copyright (c) 2021 Rob Stoll
+ * Copyright (c) 2021 Pete Willemsen
+ *
+ * This file is part of QES-Winds
+ *
+ * GPL-3.0 License
+ *
+ * QES-Winds is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * QES-Winds is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QES-Winds. If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+/*
+ * This class stores a triangle mesh as a structure of arrays: the
+ * coordinates of the vertices, shared by the triangles that use them,
+ * and three vertex indices per triangle.
+ */
+
+#include <vector>
+
+#include "Triangle.h"
+
+class TrianglePool
+{
+public:
+	std::vector<float> x, y, z;     // Coordinates of the vertices
+	std::vector<int> corners;       // Vertex indices, 3 per triangle
+
+	/*
+	 * Reserves the storage for a number of vertices and triangles
+	 */
+	void reserve(int numVertices, int numTriangles);
+
+	/*
+	 * Removes all the vertices and triangles
+	 */
+	void clear();
+
+	/*
+	 * Adds a vertex and returns its index
+	 */
+	int addVertex(float vx, float vy, float vz);
+
+	/*
+	 * Adds the triangle with the corners a, b and c (vertex indices)
+	 */
+	void addTriangle(int a, int b, int c);
+
+	/*
+	 * Finds the vertices with the same coordinates with a hash table,
+	 * in O(n). The welded vertices are numbered in the order of their
+	 * first occurrence.
+	 *
+	 * @param vertexMap -welded index of each vertex
+	 * @param welded -index of the first occurrence of each welded vertex
+	 */
+	void weld(std::vector<int> &vertexMap, std::vector<int> &welded) const;
+
+	int numVertices() const
+	{
+		return x.size();
+	}
+
+	int numTriangles() const
+	{
+		return corners.size() / 3;
+	}
+
+	/*
+	 * Copies the coordinates of the corners of triangle t
+	 */
+	void getCorners(int t, float a[3], float b[3], float c[3]) const
+	{
+		int ia = corners[3*t], ib = corners[3*t+1], ic = corners[3*t+2];
+		a[0] = x[ia];  a[1] = y[ia];  a[2] = z[ia];
+		b[0] = x[ib];  b[1] = y[ib];  b[2] = z[ib];
+		c[0] = x[ic];  c[1] = y[ic];  c[2] = z[ic];
+	}
+
+	/*
+	 * gets the minimum and maximum values of triangle t in the x y and
+	 * z dimensions (as Triangle::getBoundaries)
+	 */
+	void getBoundaries(int t, float& xmin, float& xmax, float& ymin, float& ymax, float& zmin, float& zmax) const;
+
+	/*
+	 * Vertical ray cast from point x y at height 0 to triangle t (as
+	 * Triangle::getHeightTo)
+	 *
+	 * @return the length of the ray before intersection, -1 if there is none
+	 */
+	float getHeightTo(int t, float px, float py) const;
+};
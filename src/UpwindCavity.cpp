@@ -317,3 +317,62 @@ void PolyBuilding::upwindCavity (const WINDSInputData* WID, WINDSGeneralData* WG
     }
   }
 }
+
+
+/**
+*
+* This function gives the cells that the upwind cavity may read or write: the limits of the upwind
+* areas of the faces that face the wind at the roof centroid, as found by upwindCavity (with a margin
+* of one cell for the rounding).
+*
+*/
+void PolyBuilding::upwindCavityCells (const WINDSGeneralData* WGD, CellBox &box) const
+{
+  float tol = 10.0*M_PI/180.0;
+  float height_factor = 0.6;
+  int k_top = k_start;
+  for (auto k=k_start; k<WGD->z.size(); k++)
+  {
+    k_top = k+1;
+    if (height_factor*H + base_height <= WGD->z[k])
+    {
+      break;
+    }
+  }
+  if (k_top <= k_start)
+  {
+    return;
+  }
+
+  int index_building_face = i_building_cent + j_building_cent*WGD->nx + (k_end)*WGD->nx*WGD->ny;
+  float upwind_dir = atan2(WGD->v0[index_building_face], WGD->u0[index_building_face]);
+  for (auto id=0; id<polygonVertices.size()-1; id++)
+  {
+    float xf1 = 0.5*(polygonVertices[id].x_poly-polygonVertices[id+1].x_poly)*cos(upwind_dir)+
+                0.5*(polygonVertices[id].y_poly-polygonVertices[id+1].y_poly)*sin(upwind_dir);
+    float yf1 = -0.5*(polygonVertices[id].x_poly-polygonVertices[id+1].x_poly)*sin(upwind_dir)+
+                0.5*(polygonVertices[id].y_poly-polygonVertices[id+1].y_poly)*cos(upwind_dir);
+    float xf2 = 0.5*(polygonVertices[id+1].x_poly-polygonVertices[id].x_poly)*cos(upwind_dir)+
+                0.5*(polygonVertices[id+1].y_poly-polygonVertices[id].y_poly)*sin(upwind_dir);
+    float yf2 = -0.5*(polygonVertices[id+1].x_poly-polygonVertices[id].x_poly)*sin(upwind_dir)+
+                0.5*(polygonVertices[id+1].y_poly-polygonVertices[id].y_poly)*cos(upwind_dir);
+    float rel_dir = atan2(yf2-yf1,xf2-xf1)+0.5*M_PI;
+    if (rel_dir > M_PI+0.0001)
+    {
+      rel_dir -= 2*M_PI;
+    }
+    if (abs(rel_dir) > M_PI-tol)
+    {
+      float face_length = sqrt(pow(xf2-xf1,2.0)+pow(yf2-yf1,2.0));
+      float Lf = abs(WGD->lengthf_coeff*face_length*cos(rel_dir)/(1+0.8*face_length/H));
+      int i_start = MAX_S(std::round(MIN_S(polygonVertices[id].x_poly, polygonVertices[id+1].x_poly)/WGD->dx)-std::round(1.5*Lf/WGD->dx)-1, 1);
+      int i_end = MIN_S(std::round(MAX_S(polygonVertices[id].x_poly, polygonVertices[id+1].x_poly)/WGD->dx)+std::round(1.5*Lf/WGD->dx), WGD->nx-2);
+      int j_start = MAX_S(std::round(MIN_S(polygonVertices[id].y_poly, polygonVertices[id+1].y_poly)/WGD->dy)-std::round(1.5*Lf/WGD->dy)-1, 1);
+      int j_end = MIN_S(std::round(MAX_S(polygonVertices[id].y_poly, polygonVertices[id+1].y_poly)/WGD->dy)+std::round(1.5*Lf/WGD->dy), WGD->ny-2);
+      if (i_start < i_end && j_start < j_end)
+      {
+        box.add(i_start-1, i_end, j_start-1, j_end, k_start, k_top-1);
+      }
+    }
+  }
+}
@@ -32,6 +32,8 @@
 
 
 #include "WINDSGeneralData.h"
+#include "Timers.h"
+#include "BuildingScheduler.h"
 
 WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
 {
@@ -270,13 +272,29 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
 
    std::cout << "Memory allocation complete." << std::endl;
 
+   // Restore the time-invariant geometry (terrain, cell flags, walls
+   // and solver coefficients) if the geometry cache has been found.
+   // Otherwise it is computed below and saved in the cache.
+   if (WID->simParams->geometryCache && WID->simParams->geometryCache->isLoaded())
+   {
+      geometryFromCache = readGeometryCache(WID);
+      if (!geometryFromCache)
+      {
+         std::cerr << "[WARNING] The geometry cache does not match the domain, computing the geometry" << std::endl;
+         WID->simParams->loadTerrain();
+      }
+   }
+
    /// defining ground solid cells (ghost cells below the surface)
-   for (int j = 0; j < ny-1; j++)
+   if (!geometryFromCache)
    {
-      for (int i = 0; i < nx-1; i++)
+      for (int j = 0; j < ny-1; j++)
       {
-         int icell_cent = i + j*(nx-1);
-         icellflag[icell_cent] = 2;
+         for (int i = 0; i < nx-1; i++)
+         {
+            int icell_cent = i + j*(nx-1);
+            icellflag[icell_cent] = 2;
+         }
       }
    }
 
@@ -285,8 +303,10 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    int halo_index_y = (WID->simParams->halo_y/dy);
    //WID->simParams->halo_y = halo_index_y*dy;
 
-   if (WID->simParams->DTE_heightField)
+   if (WID->simParams->DTE_heightField && !geometryFromCache)
    {
+      ScopedTimer timer("terrain height");
+
       // ////////////////////////////////
       // Retrieve terrain height field //
       // ////////////////////////////////
@@ -298,7 +318,7 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
             int ii = i+WID->simParams->halo_x/dx;
             int jj = j+WID->simParams->halo_y/dy;
             int idx = ii + jj*(nx-1);
-            terrain[idx] = WID->simParams->DTE_mesh->getHeight(i * dx + dx * 0.5f, j * dy + dy * 0.5f);
+            terrain[idx] = WID->simParams->DTE_heightField->getHeight(i * dx + dx * 0.5f, j * dy + dy * 0.5f);
             if (terrain[idx] < 0.0)
             {
                terrain[idx] = 0.0;
@@ -343,11 +363,12 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    ////////////////////////////////////////////////////////
 
 
-   if (WID->simParams->DTE_heightField)
+   if (WID->simParams->DTE_heightField && !geometryFromCache)
    {
 
       if (WID->simParams->meshTypeFlag == 0 && WID->simParams->readCoefficientsFlag == 0)
       {
+        ScopedTimer timer("terrain stair-step");
         auto start_stair = std::chrono::high_resolution_clock::now();
         for (int i = 0; i < nx-halo_index_x-1; i++)
         {
@@ -379,6 +400,73 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
         std::chrono::duration<float> elapsed_stair = finish_stair - start_stair;
         std::cout << "Elapsed time for terrain with stair-step: " << elapsed_stair.count() << " s\n";
       }
+      else if (WID->simParams->meshTypeFlag == 1 && WID->simParams->readCoefficientsFlag == 0)
+      {
+        ScopedTimer timer("terrain cut-cells");
+
+        // ////////////////////////////////
+        // Cut-cell method               //
+        // ////////////////////////////////
+        CutCells cutCells;
+        WID->simParams->DTE_heightField->setCells(cutCells, nx, ny, nz, dx, dy, dz_array, z_face,
+                                                  WID->simParams->halo_x, WID->simParams->halo_y);
+
+        // Terrain below the cut-cells of each column
+#pragma omp parallel for
+        for (int k = 1; k < nz-1; k++)
+        {
+           for (int j = 0; j < ny-1; j++)
+           {
+              for (int i = 0; i < nx-1; i++)
+              {
+                 if (cutCells.isTerrain(i, j, k))
+                 {
+                    int icell_cent = i + j*(nx-1) + k*(nx-1)*(ny-1);
+                    icellflag[icell_cent] = cutCells.isCutCell(i, j, k) ? 8 : 2;
+                 }
+              }
+           }
+        }
+
+        // Solver coefficients of the cut-cells: open fraction of each face
+#pragma omp parallel for
+        for (long c = 0; c < cutCells.numCutCells(); c++)
+        {
+           long icell_cent = cutCells.getCellId(c);
+           int k = icell_cent / ((nx-1)*(ny-1));
+           e[icell_cent] = cutCells.getFaceFluidArea(c, 2) / (dy*dz_array[k]);
+           f[icell_cent] = cutCells.getFaceFluidArea(c, 3) / (dy*dz_array[k]);
+           g[icell_cent] = cutCells.getFaceFluidArea(c, 1) / (dx*dz_array[k]);
+           h[icell_cent] = cutCells.getFaceFluidArea(c, 0) / (dx*dz_array[k]);
+           m[icell_cent] = cutCells.getFaceFluidArea(c, 5) / (dx*dy);
+           n[icell_cent] = cutCells.getFaceFluidArea(c, 4) / (dx*dy);
+
+           // The faces next to air cells are open: the terrain can only
+           // touch them along an edge, which the face points may miss
+           int i = icell_cent % (nx-1);
+           int j = (icell_cent / (nx-1)) % (ny-1);
+           if (icellflag[icell_cent+1] == 1)
+           {
+              e[icell_cent] = 1.0;
+           }
+           if (i > 0 && icellflag[icell_cent-1] == 1)
+           {
+              f[icell_cent] = 1.0;
+           }
+           if (icellflag[icell_cent+(nx-1)] == 1)
+           {
+              g[icell_cent] = 1.0;
+           }
+           if (j > 0 && icellflag[icell_cent-(nx-1)] == 1)
+           {
+              h[icell_cent] = 1.0;
+           }
+           if (icellflag[icell_cent+(nx-1)*(ny-1)] == 1)
+           {
+              m[icell_cent] = 1.0;
+           }
+        }
+      }
    }
    ///////////////////////////////////////////////////////
    //////   END of  Apply Terrain code       /////
@@ -397,12 +485,14 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
 
    if (WID->simParams->SHPData)
    {
+      ScopedTimer timer("building setup");
       auto buildingsetup_start = std::chrono::high_resolution_clock::now(); // Start recording execution time
 
       std::vector<Building*> poly_buildings;
 
 
       float corner_height, min_height;
+      int numPolygons = WID->simParams->shpPolygons.size();
 
       std::vector<float> shpDomainSize(2), minExtent(2);
       WID->simParams->SHPData->getLocalDomain( shpDomainSize );
@@ -420,12 +510,18 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
       }
 
       // Setting base height for buildings if there is a DEM file
-      if (WID->simParams->DTE_heightField && WID->simParams->DTE_mesh)
+      if (geometryFromCache)
       {
-         for (auto pIdx = 0; pIdx < WID->simParams->shpPolygons.size(); pIdx++)
+         // Base heights restored with the geometry cache
+      }
+      else if (WID->simParams->DTE_heightField)
+      {
+         base_height.resize(numPolygons);
+#pragma omp parallel for private(corner_height, min_height)
+         for (int pIdx = 0; pIdx < numPolygons; pIdx++)
          {
             // Get base height of every corner of building from terrain height
-            min_height = WID->simParams->DTE_mesh->getHeight(WID->simParams->shpPolygons[pIdx][0].x_poly,
+            min_height = WID->simParams->DTE_heightField->getHeight(WID->simParams->shpPolygons[pIdx][0].x_poly,
                                                              WID->simParams->shpPolygons[pIdx][0].y_poly);
             if (min_height < 0)
             {
@@ -433,7 +529,7 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
             }
             for (auto lIdx = 1; lIdx < WID->simParams->shpPolygons[pIdx].size(); lIdx++)
             {
-               corner_height = WID->simParams->DTE_mesh->getHeight(WID->simParams->shpPolygons[pIdx][lIdx].x_poly,
+               corner_height = WID->simParams->DTE_heightField->getHeight(WID->simParams->shpPolygons[pIdx][lIdx].x_poly,
                                                                    WID->simParams->shpPolygons[pIdx][lIdx].y_poly);
 
                if (corner_height < min_height && corner_height >= 0.0)
@@ -441,18 +537,16 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
                   min_height = corner_height;
                }
             }
-            base_height.push_back(min_height);
+            base_height[pIdx] = min_height;
          }
       }
       else
       {
-         for (auto pIdx = 0; pIdx < WID->simParams->shpPolygons.size(); pIdx++)
-         {
-            base_height.push_back(0.0);
-         }
+         base_height.resize(numPolygons, 0.0);
       }
 
-      for (auto pIdx = 0; pIdx < WID->simParams->shpPolygons.size(); pIdx++)
+#pragma omp parallel for
+      for (int pIdx = 0; pIdx < numPolygons; pIdx++)
       {
          for (auto lIdx=0; lIdx < WID->simParams->shpPolygons[pIdx].size(); lIdx++)
          {
@@ -462,13 +556,21 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
       }
 
       std::cout << "Creating buildings from shapefile...\n";
-      // Loop to create each of the polygon buildings read in from the shapefile
-      for (auto pIdx = 0; pIdx < WID->simParams->shpPolygons.size(); pIdx++)
+      // Loop to create each of the polygon buildings read in from the
+      // shapefile. The buildings are independent but for the flags of
+      // the cells they share, which get the highest building number
+      // (see PolyBuilding::setCellFlags) as in a serial loop.
+      allBuildingsV.resize(numPolygons);
+#pragma omp parallel for schedule(dynamic, 16)
+      for (int pIdx = 0; pIdx < numPolygons; pIdx++)
       {
-         allBuildingsV.push_back (new PolyBuilding (WID, this, pIdx));
-         building_id.push_back(allBuildingsV.size()-1);
+         allBuildingsV[pIdx] = new PolyBuilding (WID, this, pIdx);
          allBuildingsV[pIdx]->setPolyBuilding(this);
          allBuildingsV[pIdx]->setCellFlags(WID, this, pIdx);
+      }
+      for (auto pIdx = 0; pIdx < numPolygons; pIdx++)
+      {
+         building_id.push_back(pIdx);
          effective_height.push_back (allBuildingsV[pIdx]->height_eff);
       }
       std::cout << "\tdone.\n";
@@ -502,6 +604,8 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    // from Building in the end...
    if ( WID->buildings )
    {
+      ScopedTimer timer("building setup");
+
       std::cout << "Consolidating building data..." << std::endl;
 
       float corner_height, min_height;
@@ -511,10 +615,14 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
          int j = allBuildingsV.size()-1;
          building_id.push_back( j );
          // Setting base height for buildings if there is a DEM file
-         if (WID->simParams->DTE_heightField && WID->simParams->DTE_mesh)
+         if (geometryFromCache)
+         {
+            // Base height restored with the geometry cache
+         }
+         else if (WID->simParams->DTE_heightField)
          {
             // Get base height of every corner of building from terrain height
-            min_height = WID->simParams->DTE_mesh->getHeight(allBuildingsV[j]->polygonVertices[0].x_poly,
+            min_height = WID->simParams->DTE_heightField->getHeight(allBuildingsV[j]->polygonVertices[0].x_poly,
                                                              allBuildingsV[j]->polygonVertices[0].y_poly);
             if (min_height < 0)
             {
@@ -522,7 +630,7 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
             }
             for (size_t lIdx = 1; lIdx < allBuildingsV[j]->polygonVertices.size(); lIdx++)
             {
-               corner_height = WID->simParams->DTE_mesh->getHeight(allBuildingsV[j]->polygonVertices[lIdx].x_poly,
+               corner_height = WID->simParams->DTE_heightField->getHeight(allBuildingsV[j]->polygonVertices[lIdx].x_poly,
                                                                    allBuildingsV[j]->polygonVertices[lIdx].y_poly);
 
                if (corner_height < min_height && corner_height >= 0.0)
@@ -549,21 +657,34 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    std::cout << "Sorting buildings by height..." << std::endl;
    mergeSort( effective_height, allBuildingsV, building_id );
 
+   // Faces of the buildings and the cells next to them, for the
+   // searches of the parameterizations
+#pragma omp parallel for schedule(dynamic, 16)
+   for (int i = 0; i < (int)allBuildingsV.size(); i++)
+   {
+      allBuildingsV[i]->setFaces(this);
+   }
+
    wall = new Wall();
 
-   std::cout << "Defining Solid Walls...\n";
-   // Boundary condition for building edges
-   wall->defineWalls(this);
-   std::cout << "Walls Defined...\n";
+   if (!geometryFromCache)
+   {
+      std::cout << "Defining Solid Walls...\n";
+      // Boundary condition for building edges
+      wall->defineWalls(this);
+      std::cout << "Walls Defined...\n";
 
-   wall->solverCoefficients (this);
+      wall->solverCoefficients (this);
+   }
 
    /////////////////////////////////////////////////////////
    /////       Read coefficients from a file            ////
    /////////////////////////////////////////////////////////
 
-   if (WID->simParams->readCoefficientsFlag == 1)
+   if (WID->simParams->readCoefficientsFlag == 1 && !geometryFromCache)
    {
+     ScopedTimer timer("read coefficients");
+
      NCDFInput = new NetCDFInput(WID->simParams->coeffFile);
 
      start = {0,0,0,0};
@@ -605,25 +726,49 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
 
    }
 
+   // Save the geometry for the next runs with the same inputs
+   if (WID->simParams->geometryCache && !geometryFromCache)
+   {
+      writeGeometryCache(WID);
+   }
+
+   if (WID->simParams->compressCoefficientsFlag == 1)
+   {
+     compressCoefficients();
+   }
+
+   // Index of the fluid cells, so the solvers skip building and terrain cells
+   TimerRegistry::instance().start("active cells");
+   activeCells = new ActiveCells(this);
+   TimerRegistry::instance().stop();
+   std::cout << "Active cells: " << activeCells->numActive << " of " << numcell_cent
+             << " (" << activeCells->numSkipped << " building/terrain cells skipped)" << std::endl;
+
+   if (WID->simParams->parameterizationDirTolerance > 0.0)
+   {
+      parameterizationCache = new ParameterizationCache(WID->simParams->parameterizationDirTolerance,
+                                                        WID->simParams->parameterizationSpeedTolerance);
+   }
+
    // ///////////////////////////////////////
    // Generic Parameterization Related Stuff
    // ///////////////////////////////////////
+   TimerRegistry::instance().start("canopy vegetation");
    for (size_t i = 0; i < allBuildingsV.size(); i++)
    {
       // for now this does the canopy stuff for us
       allBuildingsV[building_id[i]]->canopyVegetation(this);
    }
+   TimerRegistry::instance().stop();
 
    ///////////////////////////////////////////
    //   Upwind Cavity Parameterization     ///
    ///////////////////////////////////////////
    if (WID->simParams->upwindCavityFlag > 0)
    {
+      ScopedTimer timer("upwind cavity");
       std::cout << "Applying upwind cavity parameterization...\n";
-      for (size_t i = 0; i < allBuildingsV.size(); i++)
-      {
-         allBuildingsV[building_id[i]]->upwindCavity(WID, this);
-      }
+      BuildingScheduler::apply(Building::UpwindCavity, WID, this);
       std::cout << "Upwind cavity parameterization done...\n";
    }
 
@@ -632,11 +777,9 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    //////////////////////////////////////////////////
    if (WID->simParams->wakeFlag > 0)
    {
+      ScopedTimer timer("wake");
       std::cout << "Applying wake behind building parameterization...\n";
-      for (size_t i = 0; i < allBuildingsV.size(); i++)
-      {
-         allBuildingsV[building_id[i]]->polygonWake(WID, this, building_id[i]);
-      }
+      BuildingScheduler::apply(Building::Wake, WID, this);
       std::cout << "Wake behind building parameterization done...\n";
    }
 
@@ -645,11 +788,9 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    ///////////////////////////////////////////
    if (WID->simParams->streetCanyonFlag > 0)
    {
+      ScopedTimer timer("street canyon");
       std::cout << "Applying street canyon parameterization...\n";
-      for (size_t i = 0; i < allBuildingsV.size(); i++)
-      {
-         allBuildingsV[building_id[i]]->streetCanyon(this);
-      }
+      BuildingScheduler::apply(Building::StreetCanyon, WID, this);
       std::cout << "Street canyon parameterization done...\n";
    }
 
@@ -658,11 +799,9 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    ///////////////////////////////////////////
    if (WID->simParams->sidewallFlag > 0)
    {
+      ScopedTimer timer("sidewall");
       std::cout << "Applying sidewall parameterization...\n";
-      for (size_t i = 0; i < allBuildingsV.size(); i++)
-      {
-         allBuildingsV[building_id[i]]->sideWall(WID, this);
-      }
+      BuildingScheduler::apply(Building::Sidewall, WID, this);
       std::cout << "Sidewall parameterization done...\n";
    }
 
@@ -672,11 +811,9 @@ WINDSGeneralData::WINDSGeneralData(const WINDSInputData* WID, int solverType)
    ///////////////////////////////////////////
    if (WID->simParams->rooftopFlag > 0)
    {
+      ScopedTimer timer("rooftop");
       std::cout << "Applying rooftop parameterization...\n";
-      for (size_t i = 0; i < allBuildingsV.size(); i++)
-      {
-         allBuildingsV[building_id[i]]->rooftop (WID, this);
-      }
+      BuildingScheduler::apply(Building::Rooftop, WID, this);
       std::cout << "Rooftop parameterization done...\n";
    }
 
@@ -804,10 +941,131 @@ float WINDSGeneralData::canopyBisection(float ustar, float z0, float canopy_top,
 }
 
 
+void WINDSGeneralData::compressCoefficients()
+{
+   ScopedTimer timer("compress coefficients");
+
+   std::cout << "Compressing solver coefficients..." << std::endl;
+   compressedCoeff = new CompressedCoefficients(this);
+
+   size_t fullSize = 6*e.size()*sizeof(float);
+   std::cout << "\t " << compressedCoeff->numCutCells() << " cut-cells, "
+             << compressedCoeff->memoryUsage()/1.0e6 << " MB instead of " << fullSize/1.0e6 << " MB" << std::endl;
+
+   // Release the full arrays
+   std::vector<float>().swap(e);
+   std::vector<float>().swap(f);
+   std::vector<float>().swap(g);
+   std::vector<float>().swap(h);
+   std::vector<float>().swap(m);
+   std::vector<float>().swap(n);
+}
+
+
+bool WINDSGeneralData::readGeometryCache(const WINDSInputData* WID)
+{
+   ScopedTimer timer("read geometry cache");
+
+   const GeometryCache *cache = WID->simParams->geometryCache;
+   std::vector<float> xmlBaseHeight;
+
+   bool valid = cache->read("terrain", terrain) && cache->read("terrain_id", terrain_id) &&
+                cache->read("icellflag", icellflag) && cache->read("ibuilding_flag", ibuilding_flag) &&
+                cache->read("base_height", base_height) && cache->read("xml_base_height", xmlBaseHeight) &&
+                cache->read("wall_right", wall_right_indices) && cache->read("wall_left", wall_left_indices) &&
+                cache->read("wall_above", wall_above_indices) && cache->read("wall_below", wall_below_indices) &&
+                cache->read("wall_back", wall_back_indices) && cache->read("wall_front", wall_front_indices) &&
+                cache->read("e", e) && cache->read("f", f) && cache->read("g", g) &&
+                cache->read("h", h) && cache->read("m", m) && cache->read("n", n);
+
+   size_t numXMLBuildings = WID->buildings ? WID->buildings->buildings.size() : 0;
+   valid = valid && terrain.size() == (size_t)numcell_cout_2d && terrain_id.size() == (size_t)(nx*ny) &&
+           icellflag.size() == (size_t)numcell_cent && ibuilding_flag.size() == (size_t)numcell_cent &&
+           base_height.size() == WID->simParams->shpPolygons.size() && xmlBaseHeight.size() == numXMLBuildings &&
+           e.size() == (size_t)numcell_cent && f.size() == (size_t)numcell_cent && g.size() == (size_t)numcell_cent &&
+           h.size() == (size_t)numcell_cent && m.size() == (size_t)numcell_cent && n.size() == (size_t)numcell_cent;
+
+   if (!valid)
+   {
+      // Back to the initial state of the arrays
+      terrain.assign( numcell_cout_2d, 0.0 );
+      terrain_id.assign( nx*ny, 1 );
+      icellflag.assign( numcell_cent, 1 );
+      ibuilding_flag.assign( numcell_cent, -1 );
+      base_height.clear();
+      wall_right_indices.clear();
+      wall_left_indices.clear();
+      wall_above_indices.clear();
+      wall_below_indices.clear();
+      wall_back_indices.clear();
+      wall_front_indices.clear();
+      e.assign( numcell_cent, 1.0 );
+      f.assign( numcell_cent, 1.0 );
+      g.assign( numcell_cent, 1.0 );
+      h.assign( numcell_cent, 1.0 );
+      m.assign( numcell_cent, 1.0 );
+      n.assign( numcell_cent, 1.0 );
+      return false;
+   }
+
+   for (size_t i = 0; i < numXMLBuildings; i++)
+   {
+      WID->buildings->buildings[i]->base_height = xmlBaseHeight[i];
+   }
+
+   std::cout << "Geometry restored from " << cache->getFileName() << std::endl;
+   return true;
+}
+
+
+void WINDSGeneralData::writeGeometryCache(const WINDSInputData* WID)
+{
+   ScopedTimer timer("write geometry cache");
+
+   GeometryCache *cache = WID->simParams->geometryCache;
+
+   std::vector<float> xmlBaseHeight;
+   if (WID->buildings)
+   {
+      for (size_t i = 0; i < WID->buildings->buildings.size(); i++)
+      {
+         xmlBaseHeight.push_back(WID->buildings->buildings[i]->base_height);
+      }
+   }
+
+   cache->add("terrain", terrain);
+   cache->add("terrain_id", terrain_id);
+   cache->add("icellflag", icellflag);
+   cache->add("ibuilding_flag", ibuilding_flag);
+   cache->add("base_height", base_height);
+   cache->add("xml_base_height", xmlBaseHeight);
+   cache->add("wall_right", wall_right_indices);
+   cache->add("wall_left", wall_left_indices);
+   cache->add("wall_above", wall_above_indices);
+   cache->add("wall_below", wall_below_indices);
+   cache->add("wall_back", wall_back_indices);
+   cache->add("wall_front", wall_front_indices);
+   cache->add("e", e);
+   cache->add("f", f);
+   cache->add("g", g);
+   cache->add("h", h);
+   cache->add("m", m);
+   cache->add("n", n);
+
+   if (cache->write())
+   {
+      std::cout << "Geometry saved in " << cache->getFileName() << std::endl;
+   }
+}
+
+
 WINDSGeneralData::WINDSGeneralData()
 {
 }
 
 WINDSGeneralData::~WINDSGeneralData()
 {
+   delete compressedCoeff;
+   delete activeCells;
+   delete parameterizationCache;
 }
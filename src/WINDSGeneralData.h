@@ -48,6 +48,9 @@
 #include "Mesh.h"
 #include "DTEHeightField.h"
 #include "Wall.h"
+#include "CompressedCoefficients.h"
+#include "ActiveCells.h"
+#include "ParameterizationCache.h"
 #include "NetCDFInput.h"
 
 
@@ -84,6 +87,54 @@ public:
     */
     void save();
 
+    /**
+    * @brief
+    *
+    * This function replaces the coefficient arrays of the SOR solver
+    * (e,f,g,h,m,n) by their compressed form
+    */
+    void compressCoefficients();
+
+    /**
+    * @brief
+    *
+    * This function restores the time-invariant geometry (terrain, cell
+    * flags, building base heights, wall indices and solver
+    * coefficients) from the geometry cache
+    *
+    * @return false if the cache does not match the domain
+    */
+    bool readGeometryCache(const WINDSInputData* WID);
+
+    /**
+    * @brief
+    *
+    * This function saves the time-invariant geometry in the geometry
+    * cache
+    */
+    void writeGeometryCache(const WINDSInputData* WID);
+
+    /**
+    * @brief
+    *
+    * This function gets the coefficients (e,f,g,h,m,n) of a cell from
+    * either the full arrays or the compressed form
+    */
+    inline void getCoefficients(long icell_cent, int k, float c[6]) const
+    {
+        if (compressedCoeff != nullptr)
+        {
+            compressedCoeff->cell(icell_cent, k, c);
+            return;
+        }
+        c[0] = e[icell_cent];
+        c[1] = f[icell_cent];
+        c[2] = g[icell_cent];
+        c[3] = h[icell_cent];
+        c[4] = m[icell_cent];
+        c[5] = n[icell_cent];
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     //////// Variables and constants needed only in other functions-- Behnam
     //////// This can be moved to a new class (WINDSGeneralData)
@@ -122,6 +173,17 @@ public:
 
     /// Declaration of coefficients for SOR solver
     std::vector<float> e,f,g,h,m,n;
+    CompressedCoefficients *compressedCoeff = nullptr;   /**< Compressed coefficients (arrays above are empty when set) */
+
+    /// Spans of active (fluid) cells, used by the solvers to skip the
+    /// building and terrain cells
+    ActiveCells *activeCells = nullptr;
+
+    bool geometryFromCache = false;     /**< Geometry restored from the geometry cache */
+
+    /// Zones of the building parameterizations, replayed at the next
+    /// time steps while the wind at the buildings does not change
+    ParameterizationCache *parameterizationCache = nullptr;
 
     // The following are mostly used for output
     std::vector<int> icellflag;  /**< Cell index flag (0 = Building, 1 = Fluid, 2 = Terrain, 3 = Upwind cavity
@@ -180,7 +242,6 @@ public:
 
     Mesh* mesh;           // In terrain functions
 
-    Cell* cells;
     // bool DTEHFExists = false;
     //Cut_cell cut_cell;
     Wall *wall;
@@ -38,6 +38,8 @@
  * all root level information extracted from the xml.
  */
 
+#include <sstream>
+
 #include "util/ParseInterface.h"
 
 #include "SimulationParameters.h"
@@ -71,6 +73,24 @@ public:
 	     parseElement<MetParams>(false, metParams, "metParams");
          parseElement<Buildings>(false, buildings, "buildings");
 	     parseElement<Canopies>(false, canopies, "canopies");
+
+         // The buildings and the canopies of the XML file are inputs
+         // of the geometry cache too.  The canopies are numbered before
+         // the buildings, so they change the building numbers as well
+         if (simParams->geometryCacheDir != "")
+         {
+             std::ostringstream geometryXML;
+             for (const std::string name : {"buildings", "canopies"})
+             {
+                 auto geometryTree = tree.get_child_optional(name);
+                 geometryXML << name << (geometryTree ? " " : " none ");
+                 if (geometryTree)
+                 {
+                     pt::write_xml(geometryXML, *geometryTree);
+                 }
+             }
+             simParams->openGeometryCache(geometryXML.str());
+         }
     }
 
     /**
@@ -138,12 +138,20 @@ WINDSOutputWorkspace::WINDSOutputWorkspace(WINDSGeneralData *WGD,std::string out
     createAttVector("icellflag","icell flag value","--",dim_vect_cc,&(WGD_->icellflag));
 
     // attributes for coefficients for SOR solver
-    createAttVector("e","e cut-cell coefficient","--",dim_vect_cc,&(WGD_->e));
-    createAttVector("f","f cut-cell coefficient","--",dim_vect_cc,&(WGD_->f));
-    createAttVector("g","g cut-cell coefficient","--",dim_vect_cc,&(WGD_->g));
-    createAttVector("h","h cut-cell coefficient","--",dim_vect_cc,&(WGD_->h));
-    createAttVector("m","m cut-cell coefficient","--",dim_vect_cc,&(WGD_->m));
-    createAttVector("n","n cut-cell coefficient","--",dim_vect_cc,&(WGD_->n));
+    // (compressed coefficients are expanded into the workspace)
+    std::vector<float> *coef_e = &(WGD_->e), *coef_f = &(WGD_->f), *coef_g = &(WGD_->g);
+    std::vector<float> *coef_h = &(WGD_->h), *coef_m = &(WGD_->m), *coef_n = &(WGD_->n);
+    if (WGD_->compressedCoeff != nullptr) {
+        WGD_->compressedCoeff->expand(e,f,g,h,m,n);
+        coef_e = &e; coef_f = &f; coef_g = &g;
+        coef_h = &h; coef_m = &m; coef_n = &n;
+    }
+    createAttVector("e","e cut-cell coefficient","--",dim_vect_cc,coef_e);
+    createAttVector("f","f cut-cell coefficient","--",dim_vect_cc,coef_f);
+    createAttVector("g","g cut-cell coefficient","--",dim_vect_cc,coef_g);
+    createAttVector("h","h cut-cell coefficient","--",dim_vect_cc,coef_h);
+    createAttVector("m","m cut-cell coefficient","--",dim_vect_cc,coef_m);
+    createAttVector("n","n cut-cell coefficient","--",dim_vect_cc,coef_n);
 
     // attribute for the volume fraction (cut-cell)
     //createAttVector("building_volume_frac","building volume fraction","--",dim_vect_cc,&(WGD_->building_volume_frac));
@@ -59,6 +59,9 @@ private:
 
     std::vector<float> x_cc,y_cc,z_cc,z_face,dz_array;
 
+    // expanded solver coefficients (when WGD keeps them compressed)
+    std::vector<float> e,f,g,h,m,n;
+
     WINDSGeneralData* WGD_;
 
     // [FM] Feb.28.2020 OBSOLETE
@@ -35,10 +35,12 @@
 
 #include "WINDSGeneralData.h"
 #include "WINDSInputData.h"
+#include "Timers.h"
 
 
 void Wall::defineWalls(WINDSGeneralData *WGD)
 {
+  ScopedTimer timer("define walls");
 
   float dx = WGD->dx;
   float dy = WGD->dy;
@@ -545,16 +547,22 @@ void Wall::wallLogBC (WINDSGeneralData *WGD)
 
 void Wall::setVelocityZero (WINDSGeneralData *WGD)
 {
+  ScopedTimer timer("set velocity zero");
+  const ActiveCells *active = WGD->activeCells;
+
+  // Building and terrain cells are the gaps between the spans of
+  // active cells on each row
   for (auto k = 0; k < WGD->nz-1; k++)
   {
     for (auto j = 1; j < WGD->ny-1; j++)
     {
-      for (auto i = 1; i < WGD->nx-1; i++)
+      int i_gap = 0;        /// First cell of the current gap
+      for (auto s = active->rowBegin(j,k); s <= active->rowEnd(j,k); s++)
       {
-        int icell_cent = i + j*(WGD->nx-1) + k*(WGD->nx-1)*(WGD->ny-1);
-        int icell_face = i + j*WGD->nx + k*WGD->nx*WGD->ny;
-        if (WGD->icellflag[icell_cent] == 0 || WGD->icellflag[icell_cent] == 2)
+        int i_next = (s < active->rowEnd(j,k)) ? active->spanStart[s] : WGD->nx-1;
+        for (auto i = MAX_S(1, i_gap); i < i_next; i++)
         {
+          int icell_face = i + j*WGD->nx + k*WGD->nx*WGD->ny;
           WGD->u0[icell_face] = 0.0;                    /// Set velocity inside the building to zero
           WGD->u0[icell_face+1] = 0.0;
           WGD->v0[icell_face] = 0.0;                    /// Set velocity inside the building to zero
@@ -562,32 +570,52 @@ void Wall::setVelocityZero (WINDSGeneralData *WGD)
           WGD->w0[icell_face] = 0.0;                    /// Set velocity inside the building to zero
           WGD->w0[icell_face+WGD->nx*WGD->ny] = 0.0;
         }
-        if (WGD->icellflag[icell_cent] == 7 || WGD->icellflag[icell_cent] == 8)
+        if (s < active->rowEnd(j,k))
         {
-          WGD->u0[icell_face] = pow(WGD->dx, 2.0)*WGD->f[icell_cent]*WGD->u0[icell_face];
-          WGD->v0[icell_face] = pow(WGD->dy, 2.0)*WGD->h[icell_cent]*WGD->v0[icell_face];
-          WGD->w0[icell_face] = (WGD->dz_array[k]*0.5*(WGD->dz_array[k]+WGD->dz_array[k-1]))*WGD->n[icell_cent]*WGD->w0[icell_face];
-          if (WGD->icellflag[icell_cent+1] != 7 && WGD->icellflag[icell_cent+1] != 8)
-          {
-            WGD->u0[icell_face+1] = pow(WGD->dx, 2.0)*WGD->e[icell_cent]*WGD->u0[icell_face+1];
-          }
-          if (WGD->icellflag[icell_cent+(WGD->nx-1)] != 7 && WGD->icellflag[icell_cent+(WGD->nx-1)] != 8)
-          {
-            WGD->v0[icell_face+WGD->nx] = pow(WGD->dy, 2.0)*WGD->g[icell_cent]*WGD->v0[icell_face+WGD->nx];
-          }
-          if (WGD->icellflag[icell_cent+(WGD->nx-1)*(WGD->ny-1)] != 7 && WGD->icellflag[icell_cent-(WGD->nx-1)*(WGD->ny-1)] != 8)
-          {
-            WGD->w0[icell_face+(WGD->nx*WGD->ny)] = (WGD->dz_array[k]*0.5*(WGD->dz_array[k]+WGD->dz_array[k+1]))*WGD->m[icell_cent]*WGD->w0[icell_face+(WGD->nx*WGD->ny)];
-          }
+          i_gap = active->spanEnd[s];
         }
       }
     }
   }
+
+  // Cut-cells: scale the velocity by the open fraction of the faces
+  for (size_t id = 0; id < active->cutCells.size(); id++)
+  {
+    int icell_cent = active->cutCells[id];
+    int k = icell_cent / ((WGD->nx-1)*(WGD->ny-1));
+    int j = (icell_cent / (WGD->nx-1)) % (WGD->ny-1);
+    int i = icell_cent % (WGD->nx-1);
+    if (i < 1 || j < 1 || j > WGD->ny-2)
+    {
+      continue;
+    }
+    int icell_face = i + j*WGD->nx + k*WGD->nx*WGD->ny;
+
+    float c[6];     /// Coefficients e,f,g,h,m,n of the cell
+    WGD->getCoefficients(icell_cent, k, c);
+    WGD->u0[icell_face] = pow(WGD->dx, 2.0)*c[1]*WGD->u0[icell_face];
+    WGD->v0[icell_face] = pow(WGD->dy, 2.0)*c[3]*WGD->v0[icell_face];
+    WGD->w0[icell_face] = (WGD->dz_array[k]*0.5*(WGD->dz_array[k]+WGD->dz_array[k-1]))*c[5]*WGD->w0[icell_face];
+    if (WGD->icellflag[icell_cent+1] != 7 && WGD->icellflag[icell_cent+1] != 8)
+    {
+      WGD->u0[icell_face+1] = pow(WGD->dx, 2.0)*c[0]*WGD->u0[icell_face+1];
+    }
+    if (WGD->icellflag[icell_cent+(WGD->nx-1)] != 7 && WGD->icellflag[icell_cent+(WGD->nx-1)] != 8)
+    {
+      WGD->v0[icell_face+WGD->nx] = pow(WGD->dy, 2.0)*c[2]*WGD->v0[icell_face+WGD->nx];
+    }
+    if (WGD->icellflag[icell_cent+(WGD->nx-1)*(WGD->ny-1)] != 7 && WGD->icellflag[icell_cent-(WGD->nx-1)*(WGD->ny-1)] != 8)
+    {
+      WGD->w0[icell_face+(WGD->nx*WGD->ny)] = (WGD->dz_array[k]*0.5*(WGD->dz_array[k]+WGD->dz_array[k+1]))*c[4]*WGD->w0[icell_face+(WGD->nx*WGD->ny)];
+    }
+  }
 }
 
 
 void Wall::solverCoefficients (WINDSGeneralData *WGD)
 {
+  ScopedTimer timer("solver coefficients");
+
   // New boundary condition implementation
   // This needs to be done only once
   for (auto k = 1; k < WGD->nz-2; k++)
@@ -56,6 +56,8 @@ WINDSArgs::WINDSArgs()
     // [FM] the output of turbulence field linked to the flag compTurb
     //reg("turbout", "Turns on the netcdf file to write turbulence file", ArgumentParsing::NONE, 'r');
     reg("terrainout", "Turn on the output of the triangle mesh for the terrain", ArgumentParsing::NONE, 'h');
+    reg("terrainformat", "Specifies the format of the terrain mesh output: obj (default) or ply (binary)", ArgumentParsing::STRING, 'f');
+    reg("timingreport", "Specifies the JSON file for the timing report (default: <outbasename>_timing.json)", ArgumentParsing::STRING, 'p');
 }
 
 void WINDSArgs::processArguments(int argc, char *argv[])
@@ -80,6 +82,9 @@ void WINDSArgs::processArguments(int argc, char *argv[])
     else if (solveType == DYNAMIC_P) std::cout << "Solving with: Dynamic Parallel solver (GPU)" << std::endl;
     else if (solveType == Global_M) std::cout << "Solving with: Global memory solver (GPU)" << std::endl;
     else if (solveType == Shared_M) std::cout << "Solving with: Shared memory solver (GPU)" << std::endl;
+    else if (solveType == CPU_RedBlack) std::cout << "Solving with: Red-black multithreaded solver (CPU)" << std::endl;
+    else if (solveType == CPU_Multigrid) std::cout << "Solving with: Geometric multigrid solver (CPU)" << std::endl;
+    else if (solveType == CPU_PCG) std::cout << "Solving with: Preconditioned conjugate gradient solver (CPU)" << std::endl;
 
     isSet("juxtapositiontype", compareType);
     if (compareType == CPU_Type) std::cout << "Comparing against: CPU" << std::endl;
@@ -118,8 +123,13 @@ void WINDSArgs::processArguments(int argc, char *argv[])
 
         terrainOut = isSet("terrainout");
         if (terrainOut) {
+            isSet("terrainformat", terrainFormat);
+            if (terrainFormat != "obj" && terrainFormat != "ply") {
+                std::cerr << "[ERROR] Unknown terrain mesh format " << terrainFormat << " (obj or ply)" << std::endl;
+                exit(EXIT_FAILURE);
+            }
             filenameTerrain = netCDFFileBasename;
-            filenameTerrain.append("_terrainOut.obj");
+            filenameTerrain.append("_terrainOut." + terrainFormat);
             std::cout << "Terrain triangle mesh WILL be output to " << filenameTerrain << std::endl;
 
         }
@@ -131,4 +141,11 @@ void WINDSArgs::processArguments(int argc, char *argv[])
         turbOutput=false;
         terrainOut=false;
     }
+
+    isSet("timingreport", timingReportFile);
+    if (timingReportFile == "" && netCDFFileBasename != "") {
+        timingReportFile = netCDFFileBasename;
+        timingReportFile.append("_timing.json");
+    }
+    if (timingReportFile != "") std::cout << "Timing report set to " << timingReportFile << std::endl;
 }
@@ -42,7 +42,7 @@
 #include "util/ArgumentParsing.h"
 
 enum solverTypes : int
-{CPU_Type = 1, DYNAMIC_P = 2, Global_M = 3, Shared_M = 4};
+{CPU_Type = 1, DYNAMIC_P = 2, Global_M = 3, Shared_M = 4, CPU_RedBlack = 5, CPU_Multigrid = 6, CPU_PCG = 7};
 
 class WINDSArgs : public ArgumentParsing
 {
@@ -83,6 +83,10 @@ public:
     std::string netCDFFileTurb = "";
     // filename for terrain output
     std::string filenameTerrain = "";
+    // format of the terrain output (obj or ply)
+    std::string terrainFormat = "obj";
+    // JSON file for the timing of the phases of the run
+    std::string timingReportFile = "";
 
 private:
 